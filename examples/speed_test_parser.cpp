@@ -0,0 +1,378 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+// Parser performance measurements, without network: the replies are
+// fed to the parser in the chunks of typical TCP segment size
+// (1460 bytes), i.e. the way they arrive into the receive buffer.
+//
+// "restart" is the way of parsing, when the whole buffer is re-parsed
+// from byte zero on every new chunk; "resumable" continues the parsing
+// from the place where it has stopped, so the total parsing time grows
+// linearly with the pipeline size.
+//
+// "twice" validates the replies and then parses them again to build
+// result markers; "once" records the markers in the same (resumable)
+// pass.
+//
+// "find" and "simd" compare the terminator (CRLF) search of all
+// header lines of typical replies via std::string_view::find and via
+// vectorized search, which is used by the parser; "parse" is the
+// parser time for the same replies.
+//
+// "markers" and "tape" compare the time of parsing into nested markers
+// (keep_result policy) and into flat tape (tape_result policy), along
+// with the traversal of all elements of the result.
+//
+// "resp2" and "resp3" compare the parsing of the same data, replied via
+// RESP2 and via RESP3 (HELLO 3) protocols.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <bredis/Protocol.hpp>
+
+// alias namespaces
+namespace r = bredis;
+
+constexpr std::size_t chunk_size = 1460;
+
+double time_s() {
+    using namespace std;
+    unsigned long ms = chrono::system_clock::now().time_since_epoch() /
+                       chrono::microseconds(1);
+    return (double)ms / 1e6;
+}
+
+// INCR-like replies with a few GET-like ones in between
+std::string make_pipeline(std::size_t count) {
+    std::string result;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i % 10) {
+            result += ":" + std::to_string(i) + "\r\n";
+        } else {
+            result += "$12\r\nvalue-" + std::to_string(100000 + i) + "\r\n";
+        }
+    }
+    return result;
+}
+
+std::size_t parse_restart(const std::string &data, std::size_t count) {
+    using Policy = r::parsing_policy::drop_result;
+    using positive_result_t = r::parse_result_mapper_t<Policy>;
+
+    std::size_t parsed = 0;
+    for (std::size_t size = chunk_size; parsed < count; size += chunk_size) {
+        std::string_view view(data.data(), std::min(size, data.size()));
+        parsed = 0;
+        while (true) {
+            auto parse_result = r::Protocol::parse<Policy>(view);
+            auto *positive = std::get_if<positive_result_t>(&parse_result);
+            if (!positive) {
+                break;
+            }
+            ++parsed;
+            view = view.substr(positive->consumed);
+        }
+    }
+    return parsed;
+}
+
+std::size_t parse_resumable(const std::string &data, std::size_t count) {
+    r::ResumableParser<r::parsing_policy::drop_result> parser(count);
+    for (std::size_t size = chunk_size; !parser.complete();
+         size += chunk_size) {
+        std::string_view view(data.data(), std::min(size, data.size()));
+        parser.advance(view.substr(parser.position()));
+    }
+    return parser.replies_count();
+}
+
+std::size_t parse_twice(const std::string &data, std::size_t count) {
+    using positive_result_t =
+        r::parse_result_mapper_t<r::parsing_policy::keep_result>;
+
+    parse_resumable(data, count);
+    std::string_view view(data);
+    r::markers::array_holder_t results;
+    results.elements.reserve(count);
+    while (results.elements.size() < count) {
+        auto parse_result = r::Protocol::parse(view);
+        auto &positive_result = std::get<positive_result_t>(parse_result);
+        results.elements.emplace_back(std::move(positive_result.result));
+        view = view.substr(positive_result.consumed);
+    }
+    return results.elements.size();
+}
+
+std::size_t parse_once(const std::string &data, std::size_t count) {
+    r::ResumableParser<r::parsing_policy::keep_result> parser(count);
+    for (std::size_t size = chunk_size; !parser.complete();
+         size += chunk_size) {
+        std::string_view view(data.data(), std::min(size, data.size()));
+        parser.advance(view.substr(parser.position()));
+    }
+    auto result = parser.result(data.data());
+    return std::get<r::markers::array_holder_t>(result.result).elements.size();
+}
+
+// the best time of a few runs is reported, to exclude the noise of
+// first memory touches
+void measure(const char *name,
+             std::function<std::size_t(const std::string &, std::size_t)> fn,
+             std::size_t count) {
+    auto data = make_pipeline(count);
+    double best = 0;
+    for (int i = 0; i < 5; ++i) {
+        double t0 = time_s();
+        auto parsed = fn(data, count);
+        double t_elapsed = time_s() - t0;
+        if (parsed != count) {
+            std::cout << name << ": parse failure\n";
+            std::exit(1);
+        }
+        best = i ? std::min(best, t_elapsed) : t_elapsed;
+    }
+    std::cout << name << ": " << count << " replies (" << data.size()
+              << " bytes) in " << best << "s\n";
+}
+
+// the replies along with the offsets of their header lines
+struct reply_mix_t {
+    std::string data;
+    std::vector<std::size_t> lines;
+    std::size_t replies = 0;
+
+    void header(const std::string &line) {
+        lines.push_back(data.size());
+        data += line + "\r\n";
+    }
+
+    void bulk(const std::string &value) {
+        header("$" + std::to_string(value.size()));
+        data += value + "\r\n";
+    }
+};
+
+// LRANGE of 100 short items
+reply_mix_t make_lrange(std::size_t count) {
+    reply_mix_t mix;
+    for (std::size_t i = 0; i < count; ++i, ++mix.replies) {
+        mix.header("*100");
+        for (std::size_t j = 0; j < 100; ++j) {
+            mix.bulk("item:" + std::to_string(i * 100 + j));
+        }
+    }
+    return mix;
+}
+
+// HGETALL of 50 fields with JSON-like values
+reply_mix_t make_hgetall(std::size_t count, bool resp3 = false) {
+    reply_mix_t mix;
+    for (std::size_t i = 0; i < count; ++i, ++mix.replies) {
+        mix.header(resp3 ? "%50" : "*100");
+        for (std::size_t j = 0; j < 50; ++j) {
+            mix.bulk("field:" + std::to_string(j));
+            mix.bulk("{\"id\":" + std::to_string(i) + ",\"name\":\"user-" +
+                     std::to_string(j) + "\",\"active\":true}");
+        }
+    }
+    return mix;
+}
+
+// ZRANGE WITHSCORES of 50 members; RESP3 replies them as pairs with
+// double scores
+reply_mix_t make_zrange(std::size_t count, bool resp3 = false) {
+    reply_mix_t mix;
+    for (std::size_t i = 0; i < count; ++i, ++mix.replies) {
+        mix.header(resp3 ? "*50" : "*100");
+        for (std::size_t j = 0; j < 50; ++j) {
+            auto score = std::to_string(j * 3.1415926535897931);
+            if (resp3) {
+                mix.header("*2");
+            }
+            mix.bulk("member:" + std::to_string(i * 50 + j));
+            if (resp3) {
+                mix.header("," + score);
+            } else {
+                mix.bulk(score);
+            }
+        }
+    }
+    return mix;
+}
+
+// statuses, integers and errors of a write-heavy pipeline; RESP3 adds
+// booleans and nulls
+reply_mix_t make_status(std::size_t count, bool resp3 = false) {
+    reply_mix_t mix;
+    for (std::size_t i = 0; i < count; ++i, ++mix.replies) {
+        switch (i % (resp3 ? 5 : 3)) {
+        case 0:
+            mix.header("+OK");
+            break;
+        case 1:
+            mix.header(":" + std::to_string(i));
+            break;
+        case 3:
+            mix.header("#t");
+            break;
+        case 4:
+            mix.header("_");
+            break;
+        default:
+            mix.header("-WRONGTYPE Operation against a key holding the "
+                       "wrong kind of value");
+        }
+    }
+    return mix;
+}
+
+template <typename Fn> double best_time(Fn &&fn) {
+    double best = 0;
+    for (int i = 0; i < 5; ++i) {
+        double t0 = time_s();
+        fn();
+        double t_elapsed = time_s() - t0;
+        best = i ? std::min(best, t_elapsed) : t_elapsed;
+    }
+    return best;
+}
+
+void measure_terminator(const char *name, const reply_mix_t &mix) {
+    std::string_view view(mix.data);
+    std::size_t found_sum = 0;
+    auto find = best_time([&]() {
+        for (auto line : mix.lines) {
+            found_sum += view.find("\r\n", line);
+        }
+    });
+    auto simd = best_time([&]() {
+        for (auto line : mix.lines) {
+            found_sum += r::details::find_terminator(view, line);
+        }
+    });
+    auto parse = best_time([&]() {
+        auto parsed = parse_resumable(mix.data, mix.replies);
+        if (parsed != mix.replies) {
+            std::cout << name << ": parse failure\n";
+            std::exit(1);
+        }
+    });
+    std::cout << name << ": " << mix.lines.size() << " lines ("
+              << mix.data.size() << " bytes), find " << find << "s, simd "
+              << simd << "s, parse " << parse << "s"
+              << (found_sum ? "" : " ") << "\n";
+}
+
+template <typename Policy>
+r::parse_result_mapper_t<Policy> parse_chunked(const std::string &data,
+                                               std::size_t count) {
+    r::ResumableParser<Policy> parser(count);
+    for (std::size_t size = chunk_size; !parser.complete();
+         size += chunk_size) {
+        std::string_view view(data.data(), std::min(size, data.size()));
+        parser.advance(view.substr(parser.position()));
+    }
+    return parser.result(data.data());
+}
+
+// total bytes of all strings; the same visitor is used for markers and
+// for tape
+struct bytes_counter {
+    std::size_t operator()(const r::markers::string_t &value) const {
+        return value.size();
+    }
+
+    // array, map, set and push
+    template <typename Holder>
+    auto operator()(const Holder &value) const
+        -> decltype(value.elements, std::size_t{}) {
+        std::size_t bytes = 0;
+        for (const auto &element : value.elements) {
+            bytes += std::visit(*this, element);
+        }
+        return bytes;
+    }
+
+    std::size_t operator()(const r::markers::tape_cursor_t &value) const {
+        std::size_t bytes = 0;
+        for (const auto &element : value) {
+            bytes += r::markers::visit(*this, element);
+        }
+        return bytes;
+    }
+};
+
+void measure_result(const char *name, const reply_mix_t &mix) {
+    std::size_t markers_sum = 0, tape_sum = 0;
+    auto markers = best_time([&]() {
+        auto result = parse_chunked<r::parsing_policy::keep_result>(
+            mix.data, mix.replies);
+        markers_sum = std::visit(bytes_counter(), result.result);
+    });
+    auto tape = best_time([&]() {
+        auto result = parse_chunked<r::parsing_policy::tape_result>(
+            mix.data, mix.replies);
+        tape_sum = 0;
+        for (const auto &reply : result.result) {
+            tape_sum += r::markers::visit(bytes_counter(), reply);
+        }
+    });
+    if (markers_sum != tape_sum) {
+        std::cout << name << ": result mismatch\n";
+        std::exit(1);
+    }
+    std::cout << name << ": " << mix.replies << " replies ("
+              << mix.data.size() << " bytes), markers " << markers
+              << "s, tape " << tape << "s\n";
+}
+
+void measure_protocol(const char *name, const reply_mix_t &resp2,
+                      const reply_mix_t &resp3) {
+    auto parse = [&](const reply_mix_t &mix) {
+        return best_time([&]() {
+            auto result = parse_chunked<r::parsing_policy::keep_result>(
+                mix.data, mix.replies);
+            if (std::visit(bytes_counter(), result.result) == 0) {
+                std::cout << name << ": parse failure\n";
+                std::exit(1);
+            }
+        });
+    };
+    auto resp2_time = parse(resp2);
+    auto resp3_time = parse(resp3);
+    std::cout << name << ": " << resp2.replies << " replies, resp2 ("
+              << resp2.data.size() << " bytes) " << resp2_time
+              << "s, resp3 (" << resp3.data.size() << " bytes) "
+              << resp3_time << "s\n";
+}
+
+int main() {
+    for (std::size_t count : {25000, 50000, 100000}) {
+        measure("restart  ", parse_restart, count);
+        measure("resumable", parse_resumable, count);
+    }
+    for (std::size_t count : {100000, 500000}) {
+        measure("twice    ", parse_twice, count);
+        measure("once     ", parse_once, count);
+    }
+    measure_terminator("lrange ", make_lrange(5000));
+    measure_terminator("hgetall", make_hgetall(5000));
+    measure_terminator("zrange ", make_zrange(5000));
+    measure_terminator("status ", make_status(500000));
+    measure_result("hgetall", make_hgetall(2000));
+    measure_result("status ", make_status(500000));
+    measure_protocol("hgetall", make_hgetall(2000), make_hgetall(2000, true));
+    measure_protocol("zrange ", make_zrange(2000), make_zrange(2000, true));
+    measure_protocol("status ", make_status(500000),
+                     make_status(500000, true));
+    return 0;
+}
@@ -11,8 +11,16 @@
 #include <vector>
 #include <variant>
 
+#include <boost/container/small_vector.hpp>
+
 #include "Result.hpp"
 
+// The count of command arguments (including the command name), which are
+// kept inline, i.e. the typical command does not allocate
+#ifndef BREDIS_INLINE_ARGUMENTS
+#define BREDIS_INLINE_ARGUMENTS 5
+#endif
+
 namespace bredis {
 
 namespace detail {
@@ -26,7 +34,8 @@ using are_all_constructible = all_true<std::is_constructible<R, Ts>::value...>;
 
 } // namespace detail
 
-using args_container_t = std::vector<std::string_view>;
+using args_container_t =
+    boost::container::small_vector<std::string_view, BREDIS_INLINE_ARGUMENTS>;
 struct single_command_t {
     args_container_t arguments;
 
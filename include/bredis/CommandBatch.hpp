@@ -0,0 +1,162 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <boost/asio/buffer.hpp>
+
+#include "Command.hpp"
+#include "PreparedCommand.hpp"
+#include "Protocol.hpp"
+
+namespace bredis {
+
+namespace details {
+
+// the customization point for the arguments of user types: they are
+// formatted by the function found via ADL,
+// void bredis_format(std::string &out, const T &value),
+// which appends the bytes of the value to out
+template <typename T, typename = void>
+struct has_custom_format : std::false_type {};
+
+template <typename T>
+struct has_custom_format<T, std::void_t<decltype(bredis_format(
+                                std::declval<std::string &>(),
+                                std::declval<const T &>()))>>
+    : std::true_type {};
+
+// the arguments, which are formatted right into the encoded command:
+// strings, byte buffers, numbers and the user types
+template <typename T, typename U = std::decay_t<T>>
+struct is_formattable
+    : std::integral_constant<
+          bool, std::is_convertible<const U &, std::string_view>::value ||
+                    std::is_convertible<const U &,
+                                        boost::asio::const_buffer>::value ||
+                    (std::is_arithmetic<U>::value &&
+                     !std::is_same<U, bool>::value &&
+                     !std::is_same<U, char>::value) ||
+                    has_custom_format<U>::value> {};
+
+// enough for the shortest round-trip representation of double
+constexpr std::size_t max_number_size = 64;
+using number_buffer_t = std::array<char, max_number_size>;
+
+/* the bytes of the argument; the numbers are formatted into the number
+ * buffer, the user types into the scratch */
+template <typename T>
+inline std::string_view format_argument(const T &value,
+                                        number_buffer_t &number,
+                                        std::string &scratch);
+
+} // namespace details
+
+// The owning batch of commands: they are encoded right when added into the
+// single growable buffer, i.e. the arguments might be released right
+// after that, and the batch of many commands costs just a few allocations
+// (or a single one, when the size is reserved).
+//
+// The batch is written as single buffer; it must not be changed until the
+// write is finished.
+//
+// The replies might be suppressed via CLIENT REPLY commands, then the batch
+// counts only the replies, which are actually sent; the reply mode is
+// expected to be ON, when the first batch is written.
+class command_batch_t {
+  private:
+    std::string encoded_;
+    std::string scratch_;
+    std::size_t commands_ = 0;
+    std::size_t replies_ = 0;
+    // the reply mode after the batch, it persists across the batches
+    bool replying_ = true;
+
+    inline void append_header(char introduction, std::size_t value);
+    template <typename T> inline void append_argument(const T &value);
+
+    template <typename... Args> void encode(const Args &... args) {
+        append_header('*', sizeof...(Args));
+        (append_argument(args), ...);
+        ++commands_;
+    }
+
+  public:
+    /* reserves the bytes of the encoded commands */
+    void reserve(std::size_t bytes) { encoded_.reserve(bytes); }
+
+    inline command_batch_t &add(const single_command_t &cmd);
+
+    /* the arguments are strings, byte buffers (boost::asio::const_buffer),
+     * numbers (formatted via std::to_chars, the floating point ones in
+     * the shortest round-trip form) or user types with bredis_format, e.g.
+     * add("ZADD", "scores", 1.5, "member") */
+    template <typename... Args,
+              typename = std::enable_if_t<detail::all_true<
+                  details::is_formattable<Args>::value...>::value>>
+    command_batch_t &add(const Args &... args) {
+        static_assert(sizeof...(Args) >= 1, "Empty command is not allowed");
+        encode(args...);
+        replies_ += replying_;
+        return *this;
+    }
+
+    /* the command, which reply is suppressed by CLIENT REPLY SKIP */
+    template <typename... Args,
+              typename = std::enable_if_t<detail::all_true<
+                  details::is_formattable<Args>::value...>::value>>
+    command_batch_t &add_without_reply(const Args &... args) {
+        static_assert(sizeof...(Args) >= 1, "Empty command is not allowed");
+        if (replying_) {
+            encode("CLIENT", "REPLY", "SKIP");
+        }
+        encode(args...);
+        return *this;
+    }
+
+    /* the replies of the following commands are suppressed by CLIENT
+     * REPLY OFF, until reply_on() */
+    inline command_batch_t &reply_off();
+    /* CLIENT REPLY ON, it is replied with +OK */
+    inline command_batch_t &reply_on();
+
+    /* the reply mode is kept */
+    void clear() {
+        encoded_.clear();
+        commands_ = 0;
+        replies_ = 0;
+    }
+
+    /* the count of commands, including CLIENT REPLY ones */
+    std::size_t commands() const { return commands_; }
+    /* the count of expected replies */
+    std::size_t replies() const { return replies_; }
+    bool replying() const { return replying_; }
+    bool empty() const { return commands_ == 0; }
+
+    boost::asio::const_buffer buffers() const {
+        return boost::asio::buffer(encoded_);
+    }
+    /* total bytes of the encoded commands */
+    std::size_t size() const { return encoded_.size(); }
+};
+
+namespace details {
+
+template <> struct is_encoded_command<command_batch_t> : std::true_type {};
+
+} // namespace details
+
+} // namespace bredis
+
+#include "impl/command_batch.ipp"
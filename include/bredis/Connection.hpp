@@ -21,8 +21,12 @@
 #include <boost/asio/handler_type.hpp>
 
 #include "Command.hpp"
+#include "CommandBatch.hpp"
+#include "PreparedCommand.hpp"
 #include "Protocol.hpp"
 #include "Result.hpp"
+#include "StaticCommand.hpp"
+#include "Stream.hpp"
 
 namespace bredis {
 
@@ -49,24 +53,191 @@ template <typename NextLayer> class Connection {
     async_write(DynamicBuffer &tx_buff, const command_wrapper_t &command,
                 WriteCallback &&write_callback);
 
-    template <typename DynamicBuffer, typename ReadCallback>
+    /* zero-copy write: the large arguments are written right from their
+     * memory, i.e. they must outlive the write */
+    template <typename WriteCallback>
+    BOOST_ASIO_INITFN_RESULT_TYPE(WriteCallback,
+                                  void(boost::system::error_code, std::size_t))
+    async_write(const command_wrapper_t &command,
+                WriteCallback &&write_callback);
+
+    /* the encoded command (prepared_command_t, static_command_t or
+     * command_batch_t) is copied into the buffer */
+    template <typename DynamicBuffer, typename EncodedCommand,
+              typename WriteCallback,
+              typename = details::enable_if_encoded_t<EncodedCommand>>
+    BOOST_ASIO_INITFN_RESULT_TYPE(WriteCallback,
+                                  void(boost::system::error_code, std::size_t))
+    async_write(DynamicBuffer &tx_buff, const EncodedCommand &command,
+                WriteCallback &&write_callback);
+
+    /* zero-copy write of the encoded command: neither the command nor
+     * its arguments might be changed until the write is finished */
+    template <typename EncodedCommand, typename WriteCallback,
+              typename = details::enable_if_encoded_t<EncodedCommand>>
+    BOOST_ASIO_INITFN_RESULT_TYPE(WriteCallback,
+                                  void(boost::system::error_code, std::size_t))
+    async_write(const EncodedCommand &command, WriteCallback &&write_callback);
+
+    /* the commands are serialized by windows of window_size bytes: the
+     * next window is serialized into the spare buffer, while the current
+     * one is written, i.e. the memory is bounded by two windows and the
+     * first commands are sent without waiting for the whole batch. The
+     * written data is consumed from the buffer; the container (not only
+     * the arguments) must outlive the write. The callback gets the total
+     * bytes written */
+    template <typename DynamicBuffer, typename WriteCallback>
+    BOOST_ASIO_INITFN_RESULT_TYPE(WriteCallback,
+                                  void(boost::system::error_code, std::size_t))
+    async_write_windowed(DynamicBuffer &tx_buff,
+                         const command_container_t &commands,
+                         WriteCallback &&write_callback,
+                         std::size_t window_size = BREDIS_WRITE_WINDOW_SIZE);
+
+    template <typename Policy = parsing_policy::keep_result,
+              typename DynamicBuffer, typename ReadCallback>
     BOOST_ASIO_INITFN_RESULT_TYPE(ReadCallback,
                                   void(boost::system::error_code,
-                                       BREDIS_PARSE_RESULT(DynamicBuffer)))
+                                       positive_parse_result_t<Policy>))
     async_read(DynamicBuffer &rx_buff, ReadCallback &&read_callback,
-               std::size_t replies_count = 1);
+               std::size_t replies_count = 1, std::size_t offset = 0);
+
+    /* the result is kept in the storage; the callback gets reference
+     * to it */
+    template <typename Policy, typename DynamicBuffer, typename ReadCallback>
+    BOOST_ASIO_INITFN_RESULT_TYPE(ReadCallback,
+                                  void(boost::system::error_code,
+                                       positive_parse_result_t<Policy> &))
+    async_read(DynamicBuffer &rx_buff, result_storage_t<Policy> &storage,
+               ReadCallback &&read_callback, std::size_t replies_count = 1,
+               std::size_t offset = 0);
+
+    /* reads single reply; the content of bulk string reply is delivered
+     * to the chunk callback as void(std::string_view chunk, std::size_t
+     * left) as it arrives, i.e. without accumulating the whole value in
+     * the buffer; the streamed string is empty in the result. The replies
+     * of other types are read as usual */
+    template <typename DynamicBuffer, typename ChunkCallback,
+              typename ReadCallback>
+    BOOST_ASIO_INITFN_RESULT_TYPE(
+        ReadCallback,
+        void(boost::system::error_code,
+             positive_parse_result_t<parsing_policy::keep_result>))
+    async_read_stream(DynamicBuffer &rx_buff, ChunkCallback &&chunk_callback,
+                      ReadCallback &&read_callback);
+
+    /* reads single reply; the content of bulk string reply is placed
+     * right into the destination (e.g. the preallocated or mapped memory):
+     * the already received part of it is copied from the buffer, and the
+     * rest is read into the destination bypassing the buffer. The string
+     * in the result points to the destination; destination_size error is
+     * reported, when the content does not fit (it is consumed anyway).
+     * The replies of other types are read as usual */
+    template <typename DynamicBuffer, typename ReadCallback>
+    BOOST_ASIO_INITFN_RESULT_TYPE(
+        ReadCallback,
+        void(boost::system::error_code,
+             positive_parse_result_t<parsing_policy::keep_result>))
+    async_read_into(DynamicBuffer &rx_buff,
+                    boost::asio::mutable_buffer destination,
+                    ReadCallback &&read_callback);
+
+    /* reads single reply; the elements of aggregate reply at the given
+     * depth (1 for the elements of the reply itself) are delivered to the
+     * element callback as void(const markers::redis_result_t &element)
+     * as soon as they are parsed, and their bytes are consumed; the
+     * streamed aggregate is empty in the result. The replies of other
+     * types are read as usual */
+    template <typename DynamicBuffer, typename ElementCallback,
+              typename ReadCallback>
+    BOOST_ASIO_INITFN_RESULT_TYPE(
+        ReadCallback,
+        void(boost::system::error_code,
+             positive_parse_result_t<parsing_policy::keep_result>))
+    async_read_elements(DynamicBuffer &rx_buff,
+                        ElementCallback &&element_callback,
+                        ReadCallback &&read_callback, std::size_t depth = 1);
+
+    /* reads replies continuously: they are delivered to the reply handler
+     * as void(const positive_parse_result_t<Policy> &replies) as soon as
+     * they are parsed, and then consumed. Up to max_batch of the already
+     * received replies are delivered at once, wrapped into array when
+     * max_batch is greater than 1. The reading stops after replies_count
+     * replies or, when it is zero, on error (e.g. on cancellation); the
+     * read callback gets the count of the delivered replies */
+    template <typename Policy = parsing_policy::keep_result,
+              typename DynamicBuffer, typename ReplyHandler,
+              typename ReadCallback>
+    BOOST_ASIO_INITFN_RESULT_TYPE(ReadCallback,
+                                  void(boost::system::error_code, std::size_t))
+    async_dispatch(DynamicBuffer &rx_buff, ReplyHandler &&reply_handler,
+                   ReadCallback &&read_callback, std::size_t replies_count = 0,
+                   std::size_t max_batch = 1);
 
     /* synchronous interface */
     void write(const command_wrapper_t &command);
     void write(const command_wrapper_t &command, boost::system::error_code &ec);
+    template <typename EncodedCommand,
+              typename = details::enable_if_encoded_t<EncodedCommand>>
+    void write(const EncodedCommand &command);
+    template <typename EncodedCommand,
+              typename = details::enable_if_encoded_t<EncodedCommand>>
+    void write(const EncodedCommand &command, boost::system::error_code &ec);
+
+    template <typename Policy = parsing_policy::keep_result,
+              typename DynamicBuffer>
+    positive_parse_result_t<Policy> read(DynamicBuffer &rx_buff);
+
+    template <typename Policy = parsing_policy::keep_result,
+              typename DynamicBuffer>
+    positive_parse_result_t<Policy> read(DynamicBuffer &rx_buff,
+                                         boost::system::error_code &ec);
+
+    /* the result is kept in the storage; e.g. with drop_result policy
+     * many replies are validated without building the markers */
+    template <typename Policy, typename DynamicBuffer>
+    positive_parse_result_t<Policy> &
+    read(DynamicBuffer &rx_buff, result_storage_t<Policy> &storage,
+         std::size_t replies_count = 1);
+
+    template <typename Policy, typename DynamicBuffer>
+    positive_parse_result_t<Policy> &
+    read(DynamicBuffer &rx_buff, result_storage_t<Policy> &storage,
+         boost::system::error_code &ec, std::size_t replies_count = 1);
+
+    template <typename DynamicBuffer, typename ChunkCallback>
+    positive_parse_result_t<parsing_policy::keep_result>
+    read_stream(DynamicBuffer &rx_buff, ChunkCallback &&chunk_callback);
+
+    template <typename DynamicBuffer, typename ChunkCallback>
+    positive_parse_result_t<parsing_policy::keep_result>
+    read_stream(DynamicBuffer &rx_buff, ChunkCallback &&chunk_callback,
+                boost::system::error_code &ec);
 
     template <typename DynamicBuffer>
-    BREDIS_PARSE_RESULT(DynamicBuffer)
-    read(DynamicBuffer &rx_buff);
+    positive_parse_result_t<parsing_policy::keep_result>
+    read_into(DynamicBuffer &rx_buff, boost::asio::mutable_buffer destination);
 
     template <typename DynamicBuffer>
-    BREDIS_PARSE_RESULT(DynamicBuffer)
-    read(DynamicBuffer &rx_buff, boost::system::error_code &ec);
+    positive_parse_result_t<parsing_policy::keep_result>
+    read_into(DynamicBuffer &rx_buff, boost::asio::mutable_buffer destination,
+              boost::system::error_code &ec);
+
+    template <typename DynamicBuffer, typename ElementCallback>
+    positive_parse_result_t<parsing_policy::keep_result>
+    read_elements(DynamicBuffer &rx_buff, ElementCallback &&element_callback,
+                  std::size_t depth = 1);
+
+    template <typename DynamicBuffer, typename ElementCallback>
+    positive_parse_result_t<parsing_policy::keep_result>
+    read_elements(DynamicBuffer &rx_buff, ElementCallback &&element_callback,
+                  boost::system::error_code &ec, std::size_t depth = 1);
+
+  private:
+    template <typename DynamicBuffer, typename Stream, typename Callback>
+    positive_parse_result_t<parsing_policy::keep_result>
+    read_streamed(DynamicBuffer &rx_buff, Stream &stream, Callback &callback,
+                  boost::system::error_code &ec);
 };
 
 } // namespace bredis
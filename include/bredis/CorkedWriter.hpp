@@ -0,0 +1,94 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "Command.hpp"
+#include "Protocol.hpp"
+
+namespace bredis {
+
+struct cork_options_t {
+    // limits of a single write; zero means unlimited, the command larger
+    // than max_bytes is written on its own
+    std::size_t max_bytes = 0;
+    std::size_t max_commands = 0;
+    // delay of the write of the first command, so that the commands
+    // issued meanwhile are written along with it; zero means the
+    // immediate write
+    std::chrono::microseconds linger{0};
+};
+
+// Coalesces the commands issued while the previous write is in progress
+// (or while lingering) into the batches, each of them is written by a
+// single write. The commands are serialized right in async_write, i.e.
+// their arguments might be released after the invocation.
+//
+// The writer must be used from a single thread (or strand), and it must
+// outlive the writes in progress.
+template <typename NextLayer> class CorkedWriter {
+  public:
+    /* invoked as void(const boost::system::error_code &, std::size_t
+     * bytes), when the batch containing the command is written */
+    using callback_t =
+        std::function<void(const boost::system::error_code &, std::size_t)>;
+
+  private:
+    using stream_t = typename std::remove_reference<NextLayer>::type;
+
+    struct batch_t {
+        boost::asio::streambuf data;
+        std::size_t commands = 0;
+        // serialized size of the command along with its callback
+        std::vector<std::pair<std::size_t, callback_t>> callbacks;
+    };
+    using batch_ptr_t = std::unique_ptr<batch_t>;
+
+    stream_t &stream_;
+    cork_options_t options_;
+    std::optional<boost::asio::steady_timer> timer_;
+    // the front batch is being written, when writing_ is set
+    std::deque<batch_ptr_t> batches_;
+    // the already allocated batches for reuse
+    std::vector<batch_ptr_t> spare_;
+    bool writing_ = false;
+    bool lingering_ = false;
+
+    inline bool full(const batch_t &batch) const;
+    inline bool fits(const batch_t &batch, std::size_t size,
+                     std::size_t commands) const;
+    inline batch_t &open_batch(std::size_t size, std::size_t commands);
+    inline void write_front();
+
+  public:
+    explicit CorkedWriter(stream_t &stream) : stream_(stream) {}
+
+    inline void options(const cork_options_t &options);
+    const cork_options_t &options() const { return options_; }
+
+    inline void async_write(const command_wrapper_t &command,
+                            callback_t callback = {});
+
+    /* bytes of the commands, which are not written yet */
+    inline std::size_t queued() const;
+};
+
+} // namespace bredis
+
+#include "impl/corked_writer.ipp"
@@ -16,7 +16,10 @@ enum class bredis_errors {
     parser_error,
     count_conversion,
     count_range,
-    bulk_terminator
+    bulk_terminator,
+    nesting_depth,
+    offset_range,
+    destination_size
 };
 
 class bredis_category : public boost::system::error_category {
@@ -35,6 +38,12 @@ class bredis_category : public boost::system::error_category {
             return "Unacceptable count value";
         case bredis_errors::bulk_terminator:
             return "Terminator for bulk string not found";
+        case bredis_errors::nesting_depth:
+            return "Nesting depth limit exceeded";
+        case bredis_errors::offset_range:
+            return "Reply exceeds offset range of markers";
+        case bredis_errors::destination_size:
+            return "Bulk string does not fit into destination";
         }
         return "Unknown protocol error";
     }
@@ -6,9 +6,12 @@
 //
 #pragma once
 
+#include <charconv>
 #include <iterator>
+#include <limits>
 #include <stdint.h>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <variant>
 
@@ -32,19 +35,81 @@ using int_t = int64_t;
 
 struct nil_t {};
 
+using double_t = double;
+
+using bool_t = bool;
+
+// arbitrary precision number is kept as is
+struct big_number_t {
+    std::string str;
+};
+
+struct verbatim_t {
+    std::string format;
+    std::string str;
+};
+
 // forward declaration
 struct array_holder_t;
+struct map_holder_t;
+struct set_holder_t;
+struct push_holder_t;
 
 using extraction_result_t =
-    std::variant<int_t, string_t, error_t, nil_t, array_holder_t>;
+    std::variant<int_t, string_t, error_t, nil_t, array_holder_t, double_t,
+                 bool_t, big_number_t, verbatim_t, map_holder_t, set_holder_t,
+                 push_holder_t>;
 
 struct array_holder_t {
     using recursive_array_t = std::vector<extraction_result_t>;
     recursive_array_t elements;
 };
 
+// keys and values are interleaved
+struct map_holder_t {
+    array_holder_t::recursive_array_t elements;
+};
+
+struct set_holder_t {
+    array_holder_t::recursive_array_t elements;
+};
+
+struct push_holder_t {
+    array_holder_t::recursive_array_t elements;
+};
+
 } // namespace extracts
 
+namespace details {
+
+// RESP3 double is either decimal number (possibly in exponential form) or
+// one of inf, -inf and nan; the malformed value is reported with the same
+// exception as the one of integer extraction, i.e. as boost::lexical_cast
+// did before
+inline extracts::double_t parse_double(std::string_view value) {
+    using limits_t = std::numeric_limits<extracts::double_t>;
+    if (value == "inf") {
+        return limits_t::infinity();
+    } else if (value == "-inf") {
+        return -limits_t::infinity();
+    } else if (value == "nan" || value == "-nan") {
+        return limits_t::quiet_NaN();
+    }
+    auto first = value.data();
+    auto last = first + value.size();
+    if (first != last && *first == '+') {
+        ++first;
+    }
+    extracts::double_t result = 0;
+    auto [end, ec] = std::from_chars(first, last, result);
+    if (ec != std::errc() || end != last) {
+        throw boost::bad_lexical_cast();
+    }
+    return result;
+}
+
+} // namespace details
+
 struct extractor {
 
     extracts::extraction_result_t
@@ -63,16 +128,78 @@ struct extractor {
     }
 
     extracts::extraction_result_t
-    operator()(const markers::nil_t &value) const {
+    operator()(const markers::nil_t &) const {
         return extracts::nil_t{};
     }
 
+    extracts::extraction_result_t
+    operator()(const markers::double_t &value) const {
+        return extracts::double_t{details::parse_double(value)};
+    }
+
+    extracts::extraction_result_t
+    operator()(const markers::bool_t &value) const {
+        return extracts::extraction_result_t{
+            std::in_place_type<extracts::bool_t>, value.value()};
+    }
+
+    extracts::extraction_result_t
+    operator()(const markers::big_number_t &value) const {
+        return extracts::big_number_t{std::string(value)};
+    }
+
+    extracts::extraction_result_t
+    operator()(const markers::verbatim_t &value) const {
+        return extracts::verbatim_t{std::string(value.format()),
+                                    std::string(value.text())};
+    }
+
     extracts::extraction_result_t
     operator()(const markers::array_holder_t &value) const {
-        extracts::array_holder_t r;
-        r.elements.reserve(value.elements.size());
-        for (const auto &v : value.elements) {
-            r.elements.emplace_back(std::visit(*this, v));
+        return extracts::array_holder_t{extract_elements(value.elements)};
+    }
+
+    extracts::extraction_result_t
+    operator()(const markers::map_holder_t &value) const {
+        return extracts::map_holder_t{extract_elements(value.elements)};
+    }
+
+    extracts::extraction_result_t
+    operator()(const markers::set_holder_t &value) const {
+        return extracts::set_holder_t{extract_elements(value.elements)};
+    }
+
+    extracts::extraction_result_t
+    operator()(const markers::push_holder_t &value) const {
+        return extracts::push_holder_t{extract_elements(value.elements)};
+    }
+
+    extracts::extraction_result_t
+    operator()(const markers::tape_cursor_t &value) const {
+        extracts::array_holder_t::recursive_array_t elements;
+        elements.reserve(value.size());
+        for (const auto &v : value) {
+            elements.emplace_back(markers::visit(*this, v));
+        }
+        switch (value.kind()) {
+        case markers::tape_kind_t::map:
+            return extracts::map_holder_t{std::move(elements)};
+        case markers::tape_kind_t::set:
+            return extracts::set_holder_t{std::move(elements)};
+        case markers::tape_kind_t::push:
+            return extracts::push_holder_t{std::move(elements)};
+        default:
+            return extracts::array_holder_t{std::move(elements)};
+        }
+    }
+
+  private:
+    extracts::array_holder_t::recursive_array_t extract_elements(
+        const std::vector<markers::redis_result_t> &elements) const {
+        extracts::array_holder_t::recursive_array_t r;
+        r.reserve(elements.size());
+        for (const auto &v : elements) {
+            r.emplace_back(std::visit(*this, v));
         }
         return r;
     }
@@ -37,14 +37,73 @@ struct stringizer {
         return "[int] " + r;
     }
 
-    std::string operator()(const markers::nil_t &value) const {
+    std::string operator()(const markers::nil_t &) const {
         return "[nil] ";
     }
 
+    std::string operator()(const markers::double_t &value) const {
+        std::string r(value);
+        return "[double] " + r;
+    }
+
+    std::string operator()(const markers::bool_t &value) const {
+        return value.value() ? "[bool] true" : "[bool] false";
+    }
+
+    std::string operator()(const markers::big_number_t &value) const {
+        std::string r(value);
+        return "[bignum] " + r;
+    }
+
+    std::string operator()(const markers::verbatim_t &value) const {
+        std::string r(value);
+        return "[verbatim] " + r;
+    }
+
     std::string
     operator()(const markers::array_holder_t &value) const {
-        std::string r = "[array] {";
-        for (const auto &v : value.elements) {
+        return aggregate("[array] {", value.elements);
+    }
+
+    std::string operator()(const markers::map_holder_t &value) const {
+        return aggregate("[map] {", value.elements);
+    }
+
+    std::string operator()(const markers::set_holder_t &value) const {
+        return aggregate("[set] {", value.elements);
+    }
+
+    std::string operator()(const markers::push_holder_t &value) const {
+        return aggregate("[push] {", value.elements);
+    }
+
+    std::string operator()(const markers::tape_cursor_t &value) const {
+        std::string r;
+        switch (value.kind()) {
+        case markers::tape_kind_t::map:
+            r = "[map] {";
+            break;
+        case markers::tape_kind_t::set:
+            r = "[set] {";
+            break;
+        case markers::tape_kind_t::push:
+            r = "[push] {";
+            break;
+        default:
+            r = "[array] {";
+        }
+        for (const auto &v : value) {
+            r += markers::visit(*this, v) + ", ";
+        }
+        r += "}";
+        return r;
+    }
+
+  private:
+    std::string
+    aggregate(std::string r,
+              const std::vector<markers::redis_result_t> &elements) const {
+        for (const auto &v : elements) {
             r += std::visit(*this, v) + ", ";
         }
         r += "}";
@@ -64,7 +123,7 @@ class equality {
     equality(std::string str)
         : copy_(str), begin_(std::begin(copy_)), end_(std::end(copy_)) {}
 
-    template <typename T> bool operator()(const T &value) const {
+    template <typename T> bool operator()(const T &) const {
         return false;
     }
 
@@ -94,7 +153,8 @@ class equality {
 // from redis in a form
 // [[string] "subscribe", [string] channel_name, [int] subscribes_count]
 // we check only first two fields (by string equality) and ignore the
-// last (as we usually do not care)
+// last (as we usually do not care). With RESP3 the confirmation
+// comes as push frame of the same layout.
 //
 
 class check_subscription {
@@ -106,17 +166,27 @@ class check_subscription {
     template <typename Command>
     check_subscription(Command &&cmd) : cmd_{std::forward<Command>(cmd)} {}
 
-    template <typename T> bool operator()(const T &value) const {
+    template <typename T> bool operator()(const T &) const {
         return false;
     }
 
     bool
     operator()(const bredis::markers::array_holder_t &value) const {
-        if ((value.elements.size() == 3) && (cmd_.arguments.size() >= 2)) {
+        return check(value.elements);
+    }
+
+    bool operator()(const bredis::markers::push_holder_t &value) const {
+        return check(value.elements);
+    }
+
+  private:
+    bool
+    check(const std::vector<bredis::markers::redis_result_t> &elements) const {
+        if ((elements.size() == 3) && (cmd_.arguments.size() >= 2)) {
             // check case-insentensive 1st argument, which chan be subscribe or
             // psubscribe
             const auto *cmd = std::get_if<bredis::markers::string_t>(
-                &value.elements[0]);
+                &elements[0]);
             if (!cmd) {
                 return false;
             }
@@ -132,7 +202,7 @@ class check_subscription {
 
             // get the index, 3rd field as string
             const auto *idx_ref = std::get_if<bredis::markers::int_t>(
-                &value.elements[2]);
+                &elements[2]);
             if (!idx_ref) {
                 return false;
             }
@@ -153,7 +223,7 @@ class check_subscription {
             // case-sentensive channel name comparison
             const auto *channel =
                 std::get_if<bredis::markers::string_t>(
-                    &value.elements[1]);
+                    &elements[1]);
             if (!channel) {
                 return false;
             }
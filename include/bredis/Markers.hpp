@@ -6,8 +6,13 @@
 //
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <string_view>
+#include <utility>
 #include <variant>
+#include <vector>
 
 namespace bredis {
 
@@ -18,16 +23,225 @@ struct error_t : public string_t {};
 struct int_t : public string_t {};
 struct nil_t : public string_t {};
 
+// RESP3 scalars
+struct double_t : public string_t {};
+struct bool_t : public string_t {
+    bool value() const { return !empty() && front() == 't'; }
+};
+struct big_number_t : public string_t {};
+// "txt:Some string", i.e. the 3 bytes of format followed by the text
+struct verbatim_t : public string_t {
+    string_t format() const { return substr(0, 3); }
+    string_t text() const { return size() > 4 ? substr(4) : string_t{}; }
+};
+
 struct array_holder_t;
+struct map_holder_t;
+struct set_holder_t;
+struct push_holder_t;
 
 using redis_result_t =
-    std::variant<int_t, string_t, error_t,
-                   nil_t, array_holder_t>;
+    std::variant<int_t, string_t, error_t, nil_t, array_holder_t,
+                 double_t, bool_t, big_number_t, verbatim_t,
+                 map_holder_t, set_holder_t, push_holder_t>;
 
 struct array_holder_t {
     std::vector<redis_result_t> elements;
 };
 
+// keys and values are interleaved, i.e. key1, value1, key2, value2...
+struct map_holder_t {
+    std::vector<redis_result_t> elements;
+};
+
+struct set_holder_t {
+    std::vector<redis_result_t> elements;
+};
+
+// out-of-band data, e.g. pub/sub messages of RESP3 connection
+struct push_holder_t {
+    std::vector<redis_result_t> elements;
+};
+
+// Flat representation of parse results: all elements of the replies are
+// laid out in a single vector in the order of their appearance, i.e. the
+// elements of an array immediately follow the array entry itself.
+enum class tape_kind_t : std::uint8_t {
+    string,
+    error,
+    int_,
+    nil,
+    array,
+    double_,
+    bool_,
+    big_number,
+    verbatim,
+    map,
+    set,
+    push
+};
+
+// array, map, set and push are laid out on the tape the same way
+constexpr bool is_aggregate(tape_kind_t kind) {
+    return kind == tape_kind_t::array || kind == tape_kind_t::map ||
+           kind == tape_kind_t::set || kind == tape_kind_t::push;
+}
+
+// The offsets are 32-bit to keep the entries compact, i.e. the replies
+// of a single read may not exceed 4GB.
+struct tape_entry_t {
+    // offset of the content relative to the buffer start
+    std::uint32_t offset;
+    // bytes count for strings, entries count of the whole aggregate
+    // including the aggregate entry itself for aggregates
+    std::uint32_t length;
+    // elements count for aggregates (twice the pairs count for maps)
+    std::uint32_t children;
+    tape_kind_t kind;
+};
+
+class tape_iterator_t;
+
+// lightweight (pointers pair) reference to the tape element
+class tape_cursor_t {
+  private:
+    const tape_entry_t *entry_;
+    const char *buffer_;
+
+  public:
+    tape_cursor_t(const tape_entry_t *entry, const char *buffer)
+        : entry_{entry}, buffer_{buffer} {}
+
+    const tape_entry_t &entry() const { return *entry_; }
+    tape_kind_t kind() const { return entry_->kind; }
+    bool is_array() const { return entry_->kind == tape_kind_t::array; }
+    bool is_aggregate() const { return markers::is_aggregate(entry_->kind); }
+
+    /* content of non-aggregate element */
+    std::string_view str() const {
+        return std::string_view{buffer_ + entry_->offset, entry_->length};
+    }
+
+    /* elements count of aggregate */
+    std::size_t size() const { return entry_->children; }
+
+    /* the next element on the same nesting level */
+    tape_cursor_t next() const {
+        return tape_cursor_t{entry_ + (is_aggregate() ? entry_->length : 1),
+                             buffer_};
+    }
+
+    /* iteration over the elements of aggregate */
+    inline tape_iterator_t begin() const;
+    inline tape_iterator_t end() const;
+
+    bool operator==(const tape_cursor_t &other) const {
+        return entry_ == other.entry_;
+    }
+    bool operator!=(const tape_cursor_t &other) const {
+        return entry_ != other.entry_;
+    }
+};
+
+class tape_iterator_t {
+  private:
+    tape_cursor_t cursor_;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = tape_cursor_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const tape_cursor_t *;
+    using reference = const tape_cursor_t &;
+
+    explicit tape_iterator_t(tape_cursor_t cursor) : cursor_{cursor} {}
+
+    reference operator*() const { return cursor_; }
+    pointer operator->() const { return &cursor_; }
+
+    tape_iterator_t &operator++() {
+        cursor_ = cursor_.next();
+        return *this;
+    }
+    tape_iterator_t operator++(int) {
+        auto copy = *this;
+        cursor_ = cursor_.next();
+        return copy;
+    }
+
+    bool operator==(const tape_iterator_t &other) const {
+        return cursor_ == other.cursor_;
+    }
+    bool operator!=(const tape_iterator_t &other) const {
+        return cursor_ != other.cursor_;
+    }
+};
+
+tape_iterator_t tape_cursor_t::begin() const {
+    return tape_iterator_t{tape_cursor_t{entry_ + 1, buffer_}};
+}
+
+tape_iterator_t tape_cursor_t::end() const { return tape_iterator_t{next()}; }
+
+struct tape_t {
+    std::vector<tape_entry_t> entries;
+    // the buffer, which the offsets of entries are relative to
+    const char *buffer = nullptr;
+
+    /* iteration over the (top-level) replies */
+    tape_iterator_t begin() const {
+        return tape_iterator_t{tape_cursor_t{entries.data(), buffer}};
+    }
+    tape_iterator_t end() const {
+        return tape_iterator_t{
+            tape_cursor_t{entries.data() + entries.size(), buffer}};
+    }
+
+    bool empty() const { return entries.empty(); }
+    tape_cursor_t front() const { return *begin(); }
+
+    /* The tape is not bound to the buffer memory: when the buffer data
+     * is relocated (e.g. due to buffer growth), the tape is rebound to
+     * the new data start. When the bytes before the tape content have
+     * been consumed from the buffer since parsing, they are specified
+     * as consumed. */
+    void rebind(const char *data, std::size_t consumed = 0) {
+        buffer = data;
+        if (consumed) {
+            for (auto &entry : entries) {
+                entry.offset -= static_cast<std::uint32_t>(consumed);
+            }
+        }
+    }
+};
+
+// Adapts tape to the visitors of markers: the visitor is invoked with
+// the scalar markers (string_t, error_t, int_t, nil_t, double_t...) and
+// with the cursor itself for aggregates
+template <typename Visitor>
+decltype(auto) visit(Visitor &&visitor, const tape_cursor_t &cursor) {
+    switch (cursor.kind()) {
+    case tape_kind_t::string:
+        return std::forward<Visitor>(visitor)(string_t{cursor.str()});
+    case tape_kind_t::error:
+        return std::forward<Visitor>(visitor)(error_t{cursor.str()});
+    case tape_kind_t::int_:
+        return std::forward<Visitor>(visitor)(int_t{cursor.str()});
+    case tape_kind_t::nil:
+        return std::forward<Visitor>(visitor)(nil_t{cursor.str()});
+    case tape_kind_t::double_:
+        return std::forward<Visitor>(visitor)(double_t{cursor.str()});
+    case tape_kind_t::bool_:
+        return std::forward<Visitor>(visitor)(bool_t{cursor.str()});
+    case tape_kind_t::big_number:
+        return std::forward<Visitor>(visitor)(big_number_t{cursor.str()});
+    case tape_kind_t::verbatim:
+        return std::forward<Visitor>(visitor)(verbatim_t{cursor.str()});
+    default:
+        return std::forward<Visitor>(visitor)(cursor);
+    }
+}
+
 } // namespace markers
 
 } // namespace bredis
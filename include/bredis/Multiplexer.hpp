@@ -0,0 +1,154 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+
+#pragma once
+
+#include <array>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <utility>
+
+#include <boost/asio.hpp>
+
+#include "Command.hpp"
+#include "Connection.hpp"
+#include "CorkedWriter.hpp"
+#include "Markers.hpp"
+
+namespace bredis {
+
+namespace details {
+
+// the mode set by CLIENT REPLY command
+enum class reply_mode_t { on, off, skip };
+
+/* the count of replies, which redis sends for the command; the reply
+ * mode is updated by CLIENT REPLY commands */
+inline std::size_t replies_of(const single_command_t &cmd,
+                              reply_mode_t &mode);
+
+/* whether the command enters subscribed state of the connection */
+inline bool is_subscription(const single_command_t &cmd);
+
+/* pub/sub message or other out-of-band data, i.e. it is not a reply to
+ * any command; RESP2 arrays are checked only in subscribed state */
+inline bool is_unsolicited(const markers::redis_result_t &result,
+                           bool subscribed);
+
+/* the unsubscription without arguments, i.e. of all channels (or
+ * patterns, or shard channels) */
+inline bool is_unsubscription_of_all(const single_command_t &cmd);
+
+// the confirmation of (un)subscription
+struct confirmation_t {
+    // channels, patterns or shard channels, i.e. 0, 1 or 2
+    std::size_t kind;
+    bool subscribe;
+    // the subscriptions left: of shard channels, or of channels and
+    // patterns altogether
+    std::size_t count;
+};
+
+inline std::optional<confirmation_t>
+confirmation_of(const markers::redis_result_t &reply);
+
+} // namespace details
+
+// Multiplexes many in-flight commands over a single connection: the
+// commands are serialized right in async_command, and all the commands
+// issued while the previous write is in progress are coalesced into the
+// next write (see CorkedWriter). The replies are routed to the handlers in
+// the order of commands.
+//
+// The commands, which enter subscribed state, get the reply per channel;
+// CLIENT REPLY OFF/SKIP modes are taken into account. The messages of
+// subscriptions (and RESP3 push frames) are delivered to the push handler.
+//
+// Like Connection, the multiplexer must be used from a single thread (or
+// strand), and it must outlive the operations in progress.
+template <typename NextLayer, typename DynamicBuffer = boost::asio::streambuf>
+class Multiplexer {
+  public:
+    /* the reply markers point to the receive buffer, i.e. they are valid
+     * only during the handler invocation */
+    using handler_t = std::function<void(const boost::system::error_code &,
+                                         const markers::redis_result_t &)>;
+    using push_handler_t = std::function<void(const markers::redis_result_t &)>;
+
+  private:
+    struct pending_t {
+        std::size_t replies;
+        handler_t handler;
+        // the (un)subscription, which confirmations are tracked
+        bool confirmed;
+        // the count of confirmations is known only from the first one
+        bool unsubscribe_all;
+    };
+
+    Connection<NextLayer> connection_;
+    CorkedWriter<NextLayer> writer_{connection_.next_layer()};
+    DynamicBuffer rx_buff_;
+    result_storage_t<parsing_policy::keep_result> storage_;
+    bool reading_ = false;
+    bool subscribed_ = false;
+    // the subscriptions per kind (see details::confirmation_t)
+    std::array<std::size_t, 3> subscriptions_{};
+    details::reply_mode_t reply_mode_ = details::reply_mode_t::on;
+    std::deque<pending_t> pending_;
+    push_handler_t push_handler_;
+
+    inline void enqueue(const single_command_t &cmd, handler_t handler,
+                        std::size_t replies_count, bool unsubscribe_all);
+    inline void read_next();
+    inline void on_read(const boost::system::error_code &ec,
+                        positive_parse_result_t<parsing_policy::keep_result> &
+                            parse_result,
+                        std::size_t expected);
+    inline std::size_t
+    left_of(const details::confirmation_t &confirmation) const;
+    inline void track(const markers::redis_result_t &reply);
+    inline void fail(const boost::system::error_code &ec);
+
+  public:
+    template <typename... Args>
+    explicit Multiplexer(Args &&... args)
+        : connection_(std::forward<Args>(args)...) {}
+
+    Connection<NextLayer> &connection() { return connection_; }
+    NextLayer &next_layer() { return connection_.next_layer(); }
+
+    /* the handler is invoked as void(const boost::system::error_code &,
+     * const markers::redis_result_t &reply); for the commands with
+     * multiple replies (e.g. SUBSCRIBE of multiple channels) the replies
+     * are wrapped into array, for the commands without reply it is empty
+     * array. The arguments are copied, i.e. they might be released right
+     * after the invocation */
+    inline void async_command(const single_command_t &cmd, handler_t handler);
+
+    /* the same with the explicit count of replies; the unsubscription
+     * of all channels gets the confirmation per channel anyway */
+    inline void async_command(const single_command_t &cmd, handler_t handler,
+                              std::size_t replies_count);
+
+    /* batching of the writes, e.g. the linger to coalesce more commands */
+    void cork(const cork_options_t &options) { writer_.options(options); }
+
+    /* the handler of subscription messages and of other out-of-band
+     * data; without it they are dropped */
+    void on_push(push_handler_t handler) { push_handler_ = std::move(handler); }
+
+    /* whether the connection is in subscribed state */
+    bool subscribed() const { return subscribed_; }
+
+    /* commands, which replies are not yet received */
+    std::size_t pending() const { return pending_.size(); }
+};
+
+} // namespace bredis
+
+#include "impl/multiplexer.ipp"
@@ -0,0 +1,116 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+
+#pragma once
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+
+#include "Command.hpp"
+#include "Protocol.hpp"
+
+namespace bredis {
+
+namespace details {
+
+// the commands, which are written as the sequence of buffers returned by
+// their buffers() method, along with the total size()
+template <typename T> struct is_encoded_command : std::false_type {};
+
+template <typename T>
+using enable_if_encoded_t = std::enable_if_t<is_encoded_command<T>::value>;
+
+} // namespace details
+
+// The command of the same shape sent many times: the protocol framing
+// along with the fixed arguments is encoded once, upon construction, and
+// only the variable arguments are encoded, when they are bound.
+//
+// After binding the command is the sequence of buffers for scatter/gather
+// write, which refer the bound values, i.e. they must outlive the write,
+// and the command must not be rebound until the write is finished.
+class prepared_command_t {
+  private:
+    // the encoded fixed parts around the variable arguments, the parts
+    // after them start with the terminator of the argument
+    std::string encoded_;
+    std::vector<std::size_t> parts_;
+    // the headers of the bound arguments, each of them has the slot of
+    // max_header bytes reserved upon construction
+    std::string headers_;
+    std::vector<std::size_t> header_sizes_;
+    std::vector<std::string_view> values_;
+    // refer the members above, i.e. they are rebuilt upon copy and move
+    std::vector<boost::asio::const_buffer> buffers_;
+    std::size_t size_ = 0;
+
+    inline void bind_values(const std::string_view *values, std::size_t count);
+    inline void update_buffers();
+
+  public:
+    using value_type = boost::asio::const_buffer;
+    using const_iterator =
+        std::vector<boost::asio::const_buffer>::const_iterator;
+
+    /* the arguments of the pattern at the variable positions are just
+     * placeholders, e.g. prepared_command_t({"INCR", ""}, {1}) */
+    inline prepared_command_t(const single_command_t &pattern,
+                              std::initializer_list<std::size_t> variable);
+
+    inline prepared_command_t(const prepared_command_t &other);
+    inline prepared_command_t(prepared_command_t &&other);
+    inline prepared_command_t &operator=(const prepared_command_t &other);
+    inline prepared_command_t &operator=(prepared_command_t &&other);
+
+    /* the count of variable arguments */
+    std::size_t arity() const { return parts_.size() - 1; }
+
+    /* binds the variable arguments in the order of their positions;
+     * throws std::invalid_argument, unless there are exactly arity() */
+    template <typename... Args> prepared_command_t &bind(Args &&... args) {
+        static_assert(detail::are_all_constructible<std::string_view,
+                                                    Args...>::value,
+                      "Arguments must be convertible to string_view");
+        const std::string_view values[] = {std::string_view(args)..., {}};
+        bind_values(values, sizeof...(Args));
+        return *this;
+    }
+
+    // the view of the bound buffers, which is cheap to copy into the
+    // write operation
+    struct buffers_t {
+        using value_type = boost::asio::const_buffer;
+        using const_iterator = prepared_command_t::const_iterator;
+
+        const_iterator first;
+        const_iterator last;
+
+        const_iterator begin() const { return first; }
+        const_iterator end() const { return last; }
+    };
+
+    const_iterator begin() const { return buffers_.begin(); }
+    const_iterator end() const { return buffers_.end(); }
+    buffers_t buffers() const { return {buffers_.begin(), buffers_.end()}; }
+    /* total bytes of the bound command */
+    std::size_t size() const { return size_; }
+};
+
+namespace details {
+
+template <> struct is_encoded_command<prepared_command_t> : std::true_type {};
+
+} // namespace details
+
+} // namespace bredis
+
+#include "impl/prepared_command.ipp"
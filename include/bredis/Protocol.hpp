@@ -6,13 +6,36 @@
 //
 #pragma once
 
+#include <array>
 #include <boost/asio/buffers_iterator.hpp>
+#include <cstdint>
+#include <memory>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include "Command.hpp"
 #include "Result.hpp"
 
+// Maximum nesting depth of arrays in a reply; the deeper nested reply
+// is treated as protocol error
+#ifndef BREDIS_MAX_NESTING_DEPTH
+#define BREDIS_MAX_NESTING_DEPTH 64
+#endif
+
+// The command arguments up to the size are copied along with the protocol
+// headers when writing, the larger ones are written right from the
+// caller's memory
+#ifndef BREDIS_INLINE_ARGUMENT_SIZE
+#define BREDIS_INLINE_ARGUMENT_SIZE 512
+#endif
+
+// The default amount of serialized commands, which are written at once by
+// the windowed write
+#ifndef BREDIS_WRITE_WINDOW_SIZE
+#define BREDIS_WRITE_WINDOW_SIZE 65536
+#endif
+
 namespace bredis {
 
 class Protocol {
@@ -22,7 +45,183 @@ class Protocol {
 
     static inline std::ostream &serialize(std::ostream &buff,
                                           const single_command_t &cmd);
+
+    /* exact size of the serialized command(s) */
+    static inline std::size_t serialized_size(const command_wrapper_t &command);
+
+    /* serializes the command(s) right into the space prepared once,
+     * returns the size */
+    template <typename DynamicBuffer>
+    static inline std::size_t serialize_into(DynamicBuffer &buff,
+                                             const command_wrapper_t &command);
+};
+
+// The serialized commands as a sequence of buffers for scatter/gather
+// write: the protocol headers (along with the small arguments) are kept
+// inside, while the large arguments are referenced, i.e. they must
+// outlive the write. The copies share the same content.
+class command_buffers_t {
+  private:
+    struct content_t {
+        std::string inlined;
+        std::vector<boost::asio::const_buffer> buffers;
+        std::size_t size = 0;
+    };
+    std::shared_ptr<content_t> content_;
+
+  public:
+    using value_type = boost::asio::const_buffer;
+    using const_iterator =
+        std::vector<boost::asio::const_buffer>::const_iterator;
+
+    inline explicit command_buffers_t(const command_wrapper_t &command);
+
+    const_iterator begin() const { return content_->buffers.begin(); }
+    const_iterator end() const { return content_->buffers.end(); }
+    /* total bytes of the serialized commands */
+    std::size_t size() const { return content_->size; }
+};
+
+namespace details {
+
+template <typename Policy> struct markup_recorder_t;
+
+// fixed-capacity stack, which lives right inside of the parser
+template <typename T, std::size_t N> class inline_stack_t {
+  private:
+    std::array<T, N> items_;
+    std::size_t size_ = 0;
+
+  public:
+    bool empty() const { return !size_; }
+    bool full() const { return size_ == N; }
+    T &back() { return items_[size_ - 1]; }
+    T *begin() { return items_.data(); }
+    T *end() { return items_.data() + size_; }
+    void push_back(const T &item) { items_[size_++] = item; }
+    void pop_back() { --size_; }
+    void clear() { size_ = 0; }
+    std::size_t size() const { return size_; }
+};
+
+// not yet parsed elements of the aggregate
+struct frame_t {
+    std::size_t left;
+    // the attribute describes the next element, i.e. it is not an
+    // element of the enclosing aggregate itself
+    bool attribute;
+};
+
+} // namespace details
+
+// Parser, which keeps its state between invocations, i.e. when a buffer
+// grows by (possibly tiny) chunks, the already examined bytes are never
+// examined again, even if the chunk boundary splits a reply (or bulk
+// string) in the middle. With keep_result and tape_result policies the
+// replies are recorded into the tape during the same pass, so the result
+// is available without parsing the buffer again. When the parsed replies
+// are consumed from the buffer, the parser is rebased onto the reply
+// after them, which is not parsed again either.
+//
+// The view supplied to advance() must start at the offset position()
+// of the buffer, i.e. at the first not yet examined byte.
+//
+// Arrays are parsed without recursion, the counts of their not yet
+// parsed elements are kept in the fixed-size stack of
+// BREDIS_MAX_NESTING_DEPTH frames.
+//
+// Both RESP2 and RESP3 replies are accepted. The RESP3 attributes are
+// validated, but not recorded into the result.
+template <typename Policy = parsing_policy::keep_result,
+          typename Recorder = details::markup_recorder_t<Policy>>
+class ResumableParser {
+  private:
+    std::size_t expected_count_;
+    std::size_t replies_count_;
+    std::size_t start_;
+    std::size_t position_;
+    std::size_t consumed_;
+    std::size_t scanned_;
+    std::size_t bulk_left_;
+    bool in_bulk_;
+    details::inline_stack_t<details::frame_t, BREDIS_MAX_NESTING_DEPTH> frames_;
+    // the frames depth of the outermost attribute being parsed, or zero
+    std::size_t attribute_level_;
+    protocol_error_t error_;
+    Recorder recorder_;
+    // the element split between buffers of non-contiguous sequence
+    std::string gathered_;
+
+    inline void element_parsed(std::size_t position);
+
+    template <markers::tape_kind_t kind>
+    void record(const char *ptr, std::size_t offset, std::size_t size) {
+        if (!attribute_level_) {
+            recorder_.template record<kind>(ptr, offset, size);
+        }
+    }
+
+  public:
+    explicit ResumableParser(std::size_t expected_count = 1,
+                             std::size_t start = 0) {
+        reset(expected_count, start);
+    }
+
+    /* the bytes before the start offset (e.g. the replies of the
+     * previous reads, which are still in use) are not parsed */
+    inline void reset(std::size_t expected_count, std::size_t start = 0);
+    /* the same with explicit wrapping of the replies into array, e.g. the
+     * batches of replies are wrapped even if they consist of single one */
+    inline void reset(std::size_t expected_count, std::size_t start,
+                      bool wrap);
+    /* the bytes up to the end of the parsed replies have been consumed
+     * from the buffer: the parsing of the incomplete reply after them (if
+     * any) is continued from the buffer start, as the first one of the
+     * next expected_count replies */
+    inline void rebase(std::size_t expected_count, bool wrap);
+    inline std::size_t advance(std::string_view view);
+
+    /* the same for the whole (possibly non-contiguous) sequence of buffers
+     * since the buffer start; the bulk strings are skipped right in the
+     * buffers, only the header lines, which are split between buffers,
+     * are gathered */
+    template <typename ConstBufferSequence>
+    inline std::size_t advance_buffers(const ConstBufferSequence &buffers);
+
+    /* markers of the parsed replies, pointing to the buffer; in the case
+     * of multiple expected replies they are wrapped into array. Before
+     * completion these are the replies parsed so far. */
+    inline parse_result_mapper_t<Policy> result(const char *buffer);
+    /* the same, but the capacity of the already allocated result is
+     * reused */
+    inline void result(const char *buffer,
+                       parse_result_mapper_t<Policy> &into);
+
+    /* expected replies have been parsed or protocol error has been met */
+    bool complete() const {
+        return error_ || (replies_count_ == expected_count_);
+    }
+    std::size_t replies_count() const { return replies_count_; }
+    /* bytes examined since buffer start */
+    std::size_t position() const { return position_; }
+    /* bytes occupied by completely parsed replies */
+    std::size_t consumed() const { return consumed_ - start_; }
+    const protocol_error_t &error() const { return error_; }
 };
+
+// Caller-owned storage of the parser state and of the result; when it is
+// reused across reads, the capacity allocated by the previous reads is
+// retained, so the reading of similar replies does not allocate memory.
+template <typename Policy = parsing_policy::keep_result>
+struct result_storage_t {
+    ResumableParser<Policy> parser;
+    positive_parse_result_t<Policy> result{};
+
+    explicit result_storage_t(std::size_t expected_count = 1,
+                              std::size_t start = 0)
+        : parser(expected_count, start) {}
 };
 
+} // namespace bredis
+
 #include "impl/protocol.ipp"
@@ -10,6 +10,7 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 #include <variant>
 
@@ -32,6 +33,8 @@ struct not_enough_data_t {};
 namespace parsing_policy {
 struct drop_result {};
 struct keep_result {};
+// results are recorded into flat markers::tape_t
+struct tape_result {};
 } // namespace parsing_policy
 
 template <typename Policy> struct positive_parse_result_t {
@@ -39,9 +42,23 @@ template <typename Policy> struct positive_parse_result_t {
     size_t consumed;
 };
 
+// The replies are validated, but not recorded; only the error replies
+// (not nested into aggregates) are counted, and the first of them is kept
 template <>
 struct positive_parse_result_t<parsing_policy::drop_result> {
     size_t consumed;
+    size_t replies = 0;
+    size_t errors = 0;
+    // index of the first error reply and its message, which is copied
+    // only from the contiguous buffer
+    size_t first_error_index = 0;
+    std::string first_error;
+};
+
+template <>
+struct positive_parse_result_t<parsing_policy::tape_result> {
+    markers::tape_t result;
+    size_t consumed;
 };
 
 template <typename Policy> struct parse_result_mapper {
@@ -52,6 +69,34 @@ template <typename Policy>
 using parse_result_mapper_t =
     typename parse_result_mapper<Policy>::type;
 
+// Invokes the callback with the parts of the content of tape element,
+// which might be split between the buffers of non-contiguous sequence
+template <typename ConstBufferSequence, typename Callback>
+void for_each_part(const ConstBufferSequence &buffers,
+                   const markers::tape_entry_t &entry, Callback &&callback) {
+    namespace asio = boost::asio;
+
+    // offset of the current buffer since the buffer start
+    std::size_t start = 0;
+    std::size_t from = entry.offset;
+    std::size_t left = entry.length;
+    auto it = asio::buffer_sequence_begin(buffers);
+    auto end = asio::buffer_sequence_end(buffers);
+    for (; left && it != end; ++it) {
+        asio::const_buffer buffer(*it);
+        auto finish = start + buffer.size();
+        if (from < finish) {
+            auto size = std::min(left, finish - from);
+            callback(std::string_view{
+                static_cast<const char *>(buffer.data()) + (from - start),
+                size});
+            from += size;
+            left -= size;
+        }
+        start = finish;
+    }
+}
+
 template <typename Policy>
 using parse_result_t =
     std::variant<not_enough_data_t, parse_result_mapper_t<Policy>,
@@ -0,0 +1,184 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+
+#include <boost/asio/buffer.hpp>
+
+#include "Command.hpp"
+#include "PreparedCommand.hpp"
+
+namespace bredis {
+
+// The descriptors of the commands: the name along with the allowed count
+// of arguments (not including the name). The custom descriptors are
+// declared the same way.
+namespace commands {
+
+constexpr std::size_t unlimited = std::numeric_limits<std::size_t>::max();
+
+#define BREDIS_COMMAND(TYPE, NAME, MIN_ARGS, MAX_ARGS)                         \
+    struct TYPE {                                                              \
+        static constexpr std::string_view name{NAME};                          \
+        static constexpr std::size_t min_args = MIN_ARGS;                      \
+        static constexpr std::size_t max_args = MAX_ARGS;                      \
+    }
+
+BREDIS_COMMAND(del, "DEL", 1, unlimited);
+BREDIS_COMMAND(exists, "EXISTS", 1, unlimited);
+BREDIS_COMMAND(expire, "EXPIRE", 2, 3);
+BREDIS_COMMAND(get, "GET", 1, 1);
+BREDIS_COMMAND(hdel, "HDEL", 2, unlimited);
+BREDIS_COMMAND(hget, "HGET", 2, 2);
+BREDIS_COMMAND(hgetall, "HGETALL", 1, 1);
+BREDIS_COMMAND(hincrby, "HINCRBY", 3, 3);
+BREDIS_COMMAND(hset, "HSET", 3, unlimited);
+BREDIS_COMMAND(incr, "INCR", 1, 1);
+BREDIS_COMMAND(incrby, "INCRBY", 2, 2);
+BREDIS_COMMAND(lpush, "LPUSH", 2, unlimited);
+BREDIS_COMMAND(lrange, "LRANGE", 3, 3);
+BREDIS_COMMAND(mget, "MGET", 1, unlimited);
+BREDIS_COMMAND(ping, "PING", 0, 1);
+BREDIS_COMMAND(publish, "PUBLISH", 2, 2);
+BREDIS_COMMAND(rpush, "RPUSH", 2, unlimited);
+BREDIS_COMMAND(set, "SET", 2, unlimited);
+
+#undef BREDIS_COMMAND
+
+} // namespace commands
+
+namespace details {
+
+// "*N\r\n$L\r\nNAME\r\n" of the command with the given count of arguments
+template <typename Command, std::size_t Arguments> struct static_prefix {
+    static constexpr std::size_t size = header_size(Arguments + 1) +
+                                        header_size(Command::name.size()) +
+                                        Command::name.size() +
+                                        terminator.size();
+
+    static constexpr char *write_number(char *out, std::size_t value) {
+        auto end = out + digits_count(value);
+        for (auto it = end; it != out; value /= 10) {
+            *--it = static_cast<char>('0' + value % 10);
+        }
+        return end;
+    }
+
+    static constexpr char *write_terminator(char *out) {
+        for (auto c : terminator) {
+            *out++ = c;
+        }
+        return out;
+    }
+
+    static constexpr std::array<char, size> encode() {
+        std::array<char, size> result{};
+        char *out = result.data();
+        *out++ = '*';
+        out = write_terminator(write_number(out, Arguments + 1));
+        *out++ = '$';
+        out = write_terminator(write_number(out, Command::name.size()));
+        for (auto c : Command::name) {
+            *out++ = c;
+        }
+        write_terminator(out);
+        return result;
+    }
+
+    static constexpr std::array<char, size> value = encode();
+};
+
+} // namespace details
+
+// The command, which name and count of arguments are known at compile
+// time: its protocol prefix is encoded at compile time, and it is written
+// by scatter/gather write without heap allocations. The arguments are
+// referred, i.e. they (as well as the command itself) must outlive the
+// write.
+template <typename Command, std::size_t Arguments> class static_command_t {
+  private:
+    using prefix_t = details::static_prefix<Command, Arguments>;
+
+    static constexpr std::size_t max_header =
+        details::header_size(std::numeric_limits<std::size_t>::max());
+
+    std::array<std::string_view, Arguments> arguments_;
+    std::array<char, Arguments * max_header> headers_;
+    std::array<std::uint8_t, Arguments> header_sizes_;
+    std::size_t size_;
+
+    // the arguments only, i.e. not a copy of the command
+    template <typename... Args>
+    using enable_if_arguments_t = std::enable_if_t<
+        sizeof...(Args) == Arguments &&
+        std::conjunction_v<std::negation<
+            std::is_same<std::decay_t<Args>, static_command_t>>...>>;
+
+  public:
+    using buffers_t = std::array<boost::asio::const_buffer, 1 + 3 * Arguments>;
+
+    template <typename... Args, typename = enable_if_arguments_t<Args...>>
+    explicit static_command_t(Args &&... args)
+        : arguments_{std::string_view(args)...} {
+        size_ = prefix_t::size;
+        for (std::size_t i = 0; i < Arguments; ++i) {
+            auto header = headers_.data() + i * max_header;
+            auto end = details::write_header(header, '$', arguments_[i].size());
+            header_sizes_[i] = static_cast<std::uint8_t>(end - header);
+            size_ +=
+                header_sizes_[i] + arguments_[i].size() + terminator.size();
+        }
+    }
+
+    /* the sequence of buffers for scatter/gather write, which refer the
+     * command */
+    buffers_t buffers() const {
+        buffers_t result;
+        result[0] = boost::asio::buffer(prefix_t::value);
+        for (std::size_t i = 0; i < Arguments; ++i) {
+            result[1 + i * 3] = boost::asio::const_buffer(
+                headers_.data() + i * max_header, header_sizes_[i]);
+            result[2 + i * 3] = boost::asio::buffer(arguments_[i]);
+            result[3 + i * 3] = boost::asio::buffer(terminator);
+        }
+        return result;
+    }
+
+    /* total bytes of the command */
+    std::size_t size() const { return size_; }
+};
+
+/* the command with arity checked at compile time, e.g.
+ * cmd<commands::set>(key, value) */
+template <typename Command, typename... Args>
+static_command_t<Command, sizeof...(Args)> cmd(Args &&... args) {
+    static_assert(sizeof...(Args) >= Command::min_args,
+                  "Too few arguments of the command");
+    static_assert(sizeof...(Args) <= Command::max_args,
+                  "Too many arguments of the command");
+    static_assert(
+        detail::are_all_constructible<std::string_view, Args...>::value,
+        "Arguments must be convertible to string_view");
+    return static_command_t<Command, sizeof...(Args)>(
+        std::forward<Args>(args)...);
+}
+
+namespace details {
+
+template <typename Command, std::size_t Arguments>
+struct is_encoded_command<static_command_t<Command, Arguments>>
+    : std::true_type {};
+
+} // namespace details
+
+} // namespace bredis
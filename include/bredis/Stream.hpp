@@ -0,0 +1,159 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+#include <boost/asio.hpp>
+
+#include "Markers.hpp"
+#include "Protocol.hpp"
+#include "Result.hpp"
+
+namespace bredis {
+
+// Delivers the content of bulk string reply to the chunk callback as
+// soon as it arrives, so the buffer does not have to hold the whole
+// (possibly huge) value. The delivered bytes are to be consumed from
+// the buffer by the caller. The replies of other types (including nil
+// bulk string) are not streamed, they are left intact in the buffer to
+// be parsed by ResumableParser.
+class bulk_stream_t {
+  private:
+    enum class state_t { header, payload, terminator, done, not_streamed };
+
+    state_t state_;
+    std::size_t size_;
+    std::size_t left_;
+    protocol_error_t error_;
+
+  public:
+    bulk_stream_t() { reset(); }
+
+    inline void reset();
+
+    /* the data is examined since the buffer start; the chunk callback
+     * is invoked as void(std::string_view chunk, std::size_t left) for
+     * non-empty chunks; returns bytes to be consumed */
+    template <typename ConstBufferSequence, typename ChunkCallback>
+    inline std::size_t advance(const ConstBufferSequence &buffers,
+                               ChunkCallback &&chunk_callback);
+
+    /* the string has been streamed, the reply is not a bulk string, or
+     * protocol error has been met */
+    bool complete() const {
+        return error_ || state_ == state_t::done ||
+               state_ == state_t::not_streamed;
+    }
+    bool streamed() const { return state_ == state_t::done; }
+    bool not_streamed() const { return state_ == state_t::not_streamed; }
+    /* bytes count of the string, known after the header is parsed */
+    std::size_t size() const { return size_; }
+    /* bytes of the string, which are not delivered yet */
+    std::size_t left() const { return left_; }
+    /* the bytes of the string have been read bypassing the buffer, e.g.
+     * right into the user memory */
+    inline void skip(std::size_t bytes);
+    /* the marker of the streamed reply, i.e. the empty string */
+    markers::redis_result_t streamed_marker() const {
+        return markers::string_t{};
+    }
+    const protocol_error_t &error() const { return error_; }
+};
+
+namespace details {
+
+// The chunk callback of bulk_stream_t, which copies the string into the
+// destination; the string, which does not fit, is skipped.
+struct bulk_copier_t {
+    boost::asio::mutable_buffer destination;
+    std::size_t copied = 0;
+
+    bool fits(std::size_t size) const { return size <= destination.size(); }
+
+    void operator()(std::string_view chunk, std::size_t left) {
+        if (fits(copied + chunk.size() + left)) {
+            std::memcpy(static_cast<char *>(destination.data()) + copied,
+                        chunk.data(), chunk.size());
+        }
+        copied += chunk.size();
+    }
+
+    /* the destination of the next left bytes */
+    boost::asio::mutable_buffer rest(std::size_t left) const {
+        return boost::asio::buffer(destination + copied, left);
+    }
+
+    markers::string_t content() const {
+        return {static_cast<const char *>(destination.data()), copied};
+    }
+};
+
+} // namespace details
+
+// Delivers the elements of aggregate (array, map, set or push) reply one
+// by one as soon as they are parsed, so neither the buffer nor the
+// markers hold the whole (possibly huge) reply. The elements at the
+// given depth are delivered, i.e. with depth 1 the elements of the
+// reply itself; the non-empty aggregates above that depth are opened,
+// the other elements above it are delivered as they are. The delivered
+// bytes are to be consumed from the buffer by the caller. The replies of
+// other types (including nil array) are not streamed, they are left
+// intact in the buffer to be parsed by ResumableParser. The buffer data
+// must be contiguous.
+class aggregate_stream_t {
+  private:
+    enum class state_t { header, element, done, not_streamed };
+    using policy_t = parsing_policy::keep_result;
+
+    std::size_t depth_;
+    state_t state_;
+    markers::tape_kind_t kind_;
+    std::size_t count_;
+    // not yet delivered elements of the opened aggregates
+    details::inline_stack_t<std::size_t, BREDIS_MAX_NESTING_DEPTH> frames_;
+    // the parser and the markers of the current element are reused
+    ResumableParser<policy_t> parser_;
+    positive_parse_result_t<policy_t> element_;
+    std::size_t element_start_;
+    protocol_error_t error_;
+
+    inline void element_parsed();
+
+  public:
+    explicit aggregate_stream_t(std::size_t depth = 1) { reset(depth); }
+
+    inline void reset(std::size_t depth = 1);
+
+    /* the data is examined since the buffer start; the element callback
+     * is invoked as void(const markers::redis_result_t &element), the
+     * markers are valid only during the invocation; returns bytes to be
+     * consumed */
+    template <typename ConstBufferSequence, typename ElementCallback>
+    inline std::size_t advance(const ConstBufferSequence &buffers,
+                               ElementCallback &&element_callback);
+
+    /* all elements have been delivered, the reply is not an aggregate,
+     * or protocol error has been met */
+    bool complete() const {
+        return error_ || state_ == state_t::done ||
+               state_ == state_t::not_streamed;
+    }
+    bool streamed() const { return state_ == state_t::done; }
+    bool not_streamed() const { return state_ == state_t::not_streamed; }
+    /* delivered elements count */
+    std::size_t count() const { return count_; }
+    /* the marker of the streamed reply, i.e. the empty aggregate */
+    inline markers::redis_result_t streamed_marker() const;
+    const protocol_error_t &error() const { return error_; }
+};
+
+} // namespace bredis
+
+#include "impl/stream.ipp"
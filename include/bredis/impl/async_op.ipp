@@ -6,19 +6,27 @@
 //
 #pragma once
 
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <type_traits>
 #include <utility>
 
 #include <boost/asio.hpp>
 
 namespace bredis {
 
-template <typename NextLayer, typename DynamicBuffer, typename ReadCallback>
+// The storage is either owned by the operation (shared pointer), then
+// the result is moved into the callback, or it is owned by the caller
+// (raw pointer), then the callback gets reference to the result.
+template <typename NextLayer, typename DynamicBuffer, typename ReadCallback,
+          typename Policy = parsing_policy::keep_result,
+          typename StoragePtr = std::shared_ptr<result_storage_t<Policy>>>
 class async_read_op {
     NextLayer &stream_;
     DynamicBuffer &rx_buff_;
     ReadCallback callback_;
-    std::size_t replies_count_;
+    StoragePtr storage_;
 
   public:
     async_read_op(async_read_op &&) = default;
@@ -26,9 +34,14 @@ class async_read_op {
 
     template <class DeducedHandler>
     async_read_op(DeducedHandler &&deduced_handler, NextLayer &stream,
-                  DynamicBuffer &rx_buff, std::size_t replies_count)
-        : stream_(stream), rx_buff_(rx_buff), replies_count_(replies_count),
-          callback_(std::forward<ReadCallback>(deduced_handler)) {}
+                  DynamicBuffer &rx_buff, StoragePtr storage)
+        : stream_(stream), rx_buff_(rx_buff),
+          callback_(std::forward<ReadCallback>(deduced_handler)),
+          storage_(std::move(storage)) {}
+
+    /* the already received data is parsed first; the callback is never
+     * invoked from within */
+    void start();
 
     void operator()(boost::system::error_code, std::size_t bytes_transferred);
 
@@ -55,51 +68,597 @@ class async_read_op {
     }
 };
 
+template <typename NextLayer, typename DynamicBuffer, typename ReadCallback,
+          typename Policy, typename StoragePtr>
+void async_read_op<NextLayer, DynamicBuffer, ReadCallback, Policy,
+                   StoragePtr>::start() {
+    auto &parser = storage_->parser;
+    parser.advance_buffers(rx_buff_.data());
+    auto size = details::read_size(rx_buff_);
+    if (parser.complete() || !size) {
+        // empty read just completes via the stream executor
+        stream_.async_read_some(boost::asio::mutable_buffer(),
+                                std::move(*this));
+    } else {
+        stream_.async_read_some(rx_buff_.prepare(size), std::move(*this));
+    }
+}
+
+template <typename NextLayer, typename DynamicBuffer, typename ReadCallback,
+          typename Policy, typename StoragePtr>
+void async_read_op<NextLayer, DynamicBuffer, ReadCallback, Policy,
+                   StoragePtr>::operator()(boost::system::error_code
+                                               error_code,
+                                           std::size_t bytes_transferred) {
+    auto &parser = storage_->parser;
+    auto &result = storage_->result;
+
+    if (!error_code) {
+        rx_buff_.commit(bytes_transferred);
+        parser.advance_buffers(rx_buff_.data());
+        if (!parser.complete()) {
+            auto size = details::read_size(rx_buff_);
+            if (size) {
+                stream_.async_read_some(rx_buff_.prepare(size),
+                                        std::move(*this));
+                return;
+            }
+            error_code = boost::asio::error::not_found;
+        } else if (parser.error()) {
+            error_code = parser.error();
+        }
+    }
+
+    if (!error_code) {
+        // markers are already built by the parser
+        auto buffer = details::buffer_base<Policy>(rx_buff_.data());
+        parser.result(buffer, result);
+    } else {
+        result.consumed = 0;
+    }
+
+    if constexpr (std::is_pointer<StoragePtr>::value) {
+        callback_(error_code, result);
+    } else {
+        callback_(error_code, std::move(result));
+    }
+}
+
+// Streams the reply via the stream state (bulk_stream_t or
+// aggregate_stream_t); the replies, which are not streamed, are read by
+// async_read_op with the same callback.
+template <typename NextLayer, typename DynamicBuffer, typename Stream,
+          typename Callback, typename ReadCallback>
+class async_stream_op {
+    using result_t = positive_parse_result_t<parsing_policy::keep_result>;
+
+    NextLayer &stream_;
+    DynamicBuffer &rx_buff_;
+    Stream stream_state_;
+    Callback stream_callback_;
+    ReadCallback callback_;
+
+    void read_reply();
+
+  public:
+    async_stream_op(async_stream_op &&) = default;
+    async_stream_op(const async_stream_op &) = default;
+
+    template <class DeducedHandler, class DeducedCallback>
+    async_stream_op(DeducedHandler &&deduced_handler, NextLayer &stream,
+                    DynamicBuffer &rx_buff, Stream stream_state,
+                    DeducedCallback &&stream_callback)
+        : stream_(stream), rx_buff_(rx_buff),
+          stream_state_(std::move(stream_state)),
+          stream_callback_(std::forward<DeducedCallback>(stream_callback)),
+          callback_(std::forward<ReadCallback>(deduced_handler)) {}
+
+    /* the already received data is streamed first; the callback is never
+     * invoked from within */
+    void start();
+
+    void operator()(boost::system::error_code, std::size_t bytes_transferred);
+
+    friend bool asio_handler_is_continuation(async_stream_op *op) {
+        using boost::asio::asio_handler_is_continuation;
+        return asio_handler_is_continuation(std::addressof(op->callback_));
+    }
+
+    friend void *asio_handler_allocate(std::size_t size,
+                                       async_stream_op *op) {
+        using boost::asio::asio_handler_allocate;
+        return asio_handler_allocate(size, std::addressof(op->callback_));
+    }
+
+    friend void asio_handler_deallocate(void *p, std::size_t size,
+                                        async_stream_op *op) {
+        using boost::asio::asio_handler_deallocate;
+        return asio_handler_deallocate(p, size, std::addressof(op->callback_));
+    }
+
+    template <class Function>
+    friend void asio_handler_invoke(Function &&f, async_stream_op *op) {
+        using boost::asio::asio_handler_invoke;
+        return asio_handler_invoke(f, std::addressof(op->callback_));
+    }
+};
+
+template <typename NextLayer, typename DynamicBuffer, typename Stream,
+          typename Callback, typename ReadCallback>
+void async_stream_op<NextLayer, DynamicBuffer, Stream, Callback,
+                     ReadCallback>::read_reply() {
+    auto storage = std::make_shared<result_storage_t<>>();
+    async_read_op<NextLayer, DynamicBuffer, ReadCallback> async_op(
+        std::move(callback_), stream_, rx_buff_, std::move(storage));
+    async_op.start();
+}
+
+template <typename NextLayer, typename DynamicBuffer, typename Stream,
+          typename Callback, typename ReadCallback>
+void async_stream_op<NextLayer, DynamicBuffer, Stream, Callback,
+                     ReadCallback>::start() {
+    rx_buff_.consume(
+        stream_state_.advance(rx_buff_.data(), stream_callback_));
+    if (stream_state_.not_streamed()) {
+        read_reply();
+        return;
+    }
+    auto size = details::stream_read_size(rx_buff_);
+    if (stream_state_.complete() || !size) {
+        // empty read just completes via the stream executor
+        stream_.async_read_some(boost::asio::mutable_buffer(),
+                                std::move(*this));
+    } else {
+        stream_.async_read_some(rx_buff_.prepare(size), std::move(*this));
+    }
+}
+
+template <typename NextLayer, typename DynamicBuffer, typename Stream,
+          typename Callback, typename ReadCallback>
+void async_stream_op<NextLayer, DynamicBuffer, Stream, Callback,
+                     ReadCallback>::operator()(boost::system::error_code
+                                                   error_code,
+                                               std::size_t
+                                                   bytes_transferred) {
+    if (!error_code) {
+        rx_buff_.commit(bytes_transferred);
+        rx_buff_.consume(
+            stream_state_.advance(rx_buff_.data(), stream_callback_));
+        if (!stream_state_.complete()) {
+            auto size = details::stream_read_size(rx_buff_);
+            if (size) {
+                stream_.async_read_some(rx_buff_.prepare(size),
+                                        std::move(*this));
+                return;
+            }
+            error_code = boost::asio::error::not_found;
+        } else if (stream_state_.not_streamed()) {
+            read_reply();
+            return;
+        } else if (stream_state_.error()) {
+            error_code = stream_state_.error();
+        }
+    }
+
+    if (error_code) {
+        callback_(error_code, result_t{});
+        return;
+    }
+    // the content has been delivered and consumed
+    callback_(error_code, result_t{stream_state_.streamed_marker(), 0});
+}
+
+// Reads single reply; the content of bulk string reply is placed into
+// the destination: the already received part of it is copied from the
+// buffer, and the rest is read right into the destination, bypassing the
+// buffer. The replies, which are not streamed, are read by async_read_op
+// with the same callback.
+template <typename NextLayer, typename DynamicBuffer, typename ReadCallback>
+class async_read_into_op {
+    using result_t = positive_parse_result_t<parsing_policy::keep_result>;
+
+    NextLayer &stream_;
+    DynamicBuffer &rx_buff_;
+    bulk_stream_t stream_state_;
+    details::bulk_copier_t copier_;
+    ReadCallback callback_;
+    // the read into the destination is in progress
+    bool bypassing_;
+
+    void read_reply();
+    /* returns false, when the buffer is full */
+    bool read_more();
+
+  public:
+    async_read_into_op(async_read_into_op &&) = default;
+    async_read_into_op(const async_read_into_op &) = default;
+
+    template <class DeducedHandler>
+    async_read_into_op(DeducedHandler &&deduced_handler, NextLayer &stream,
+                       DynamicBuffer &rx_buff,
+                       boost::asio::mutable_buffer destination)
+        : stream_(stream), rx_buff_(rx_buff), copier_{destination},
+          callback_(std::forward<ReadCallback>(deduced_handler)),
+          bypassing_(false) {}
+
+    /* the already received data is examined first; the callback is never
+     * invoked from within */
+    void start();
+
+    void operator()(boost::system::error_code, std::size_t bytes_transferred);
+
+    friend bool asio_handler_is_continuation(async_read_into_op *op) {
+        using boost::asio::asio_handler_is_continuation;
+        return asio_handler_is_continuation(std::addressof(op->callback_));
+    }
+
+    friend void *asio_handler_allocate(std::size_t size,
+                                       async_read_into_op *op) {
+        using boost::asio::asio_handler_allocate;
+        return asio_handler_allocate(size, std::addressof(op->callback_));
+    }
+
+    friend void asio_handler_deallocate(void *p, std::size_t size,
+                                        async_read_into_op *op) {
+        using boost::asio::asio_handler_deallocate;
+        return asio_handler_deallocate(p, size, std::addressof(op->callback_));
+    }
+
+    template <class Function>
+    friend void asio_handler_invoke(Function &&f, async_read_into_op *op) {
+        using boost::asio::asio_handler_invoke;
+        return asio_handler_invoke(f, std::addressof(op->callback_));
+    }
+};
+
+template <typename NextLayer, typename DynamicBuffer, typename ReadCallback>
+void async_read_into_op<NextLayer, DynamicBuffer, ReadCallback>::read_reply() {
+    auto storage = std::make_shared<result_storage_t<>>();
+    async_read_op<NextLayer, DynamicBuffer, ReadCallback> async_op(
+        std::move(callback_), stream_, rx_buff_, std::move(storage));
+    async_op.start();
+}
+
 template <typename NextLayer, typename DynamicBuffer, typename ReadCallback>
-void async_read_op<NextLayer, DynamicBuffer, ReadCallback>::
-operator()(boost::system::error_code error_code,
-           std::size_t bytes_transferred) {
-    using Iterator = typename to_iterator<DynamicBuffer>::iterator_t;
-    using positive_result_t =
-        parse_result_mapper_t<parsing_policy::keep_result>;
+bool async_read_into_op<NextLayer, DynamicBuffer, ReadCallback>::read_more() {
+    auto left = stream_state_.left();
+    if (left && copier_.fits(stream_state_.size())) {
+        // the received part of the content has been copied
+        bypassing_ = true;
+        boost::asio::async_read(stream_, copier_.rest(left), std::move(*this));
+        return true;
+    }
+    auto size = details::stream_read_size(rx_buff_);
+    if (!size) {
+        return false;
+    }
+    stream_.async_read_some(rx_buff_.prepare(size), std::move(*this));
+    return true;
+}
 
-    positive_result_t result;
+template <typename NextLayer, typename DynamicBuffer, typename ReadCallback>
+void async_read_into_op<NextLayer, DynamicBuffer, ReadCallback>::start() {
+    rx_buff_.consume(stream_state_.advance(rx_buff_.data(), copier_));
+    if (stream_state_.not_streamed()) {
+        read_reply();
+        return;
+    }
+    if (stream_state_.complete() || !read_more()) {
+        // empty read just completes via the stream executor
+        stream_.async_read_some(boost::asio::mutable_buffer(),
+                                std::move(*this));
+    }
+}
 
+template <typename NextLayer, typename DynamicBuffer, typename ReadCallback>
+void async_read_into_op<NextLayer, DynamicBuffer, ReadCallback>::operator()(
+    boost::system::error_code error_code, std::size_t bytes_transferred) {
     if (!error_code) {
-        auto const_buff = rx_buff_.data();
-		std::string_view view(boost::asio::buffer_cast<const char*>(rx_buff_.data()), rx_buff_.size());
-
-        markers::array_holder_t results;
-        results.elements.reserve(replies_count_);
-        size_t cumulative_consumption = 0;
-
-        do {
-            auto parse_result = Protocol::parse(view);
-            if (auto *parse_error = std::get_if<protocol_error_t>(&parse_result); parse_error) {
-                error_code = *parse_error;
-                break;
-            } else {
-                auto &positive_result =
-                    std::get<positive_result_t>(parse_result);
-                results.elements.emplace_back(positive_result.result);
-                view = view.substr(positive_result.consumed);
-                cumulative_consumption += positive_result.consumed;
+        if (bypassing_) {
+            bypassing_ = false;
+            copier_.copied += bytes_transferred;
+            stream_state_.skip(bytes_transferred);
+        } else {
+            rx_buff_.commit(bytes_transferred);
+        }
+        rx_buff_.consume(stream_state_.advance(rx_buff_.data(), copier_));
+        if (!stream_state_.complete()) {
+            if (read_more()) {
+                return;
             }
-        } while (results.elements.size() < replies_count_);
-
-        /* check again, as protocol error might be met */
-        if (!error_code) {
-            if (replies_count_ == 1) {
-                result = positive_result_t{std::move(results.elements[0]),
-                                           cumulative_consumption};
-            } else {
-                result = positive_result_t{std::move(results),
-                                           cumulative_consumption};
+            error_code = boost::asio::error::not_found;
+        } else if (stream_state_.not_streamed()) {
+            read_reply();
+            return;
+        } else if (stream_state_.error()) {
+            error_code = stream_state_.error();
+        } else if (!copier_.fits(stream_state_.size())) {
+            error_code =
+                Error::make_error_code(bredis_errors::destination_size);
+        }
+    }
+
+    if (error_code) {
+        callback_(error_code, result_t{});
+        return;
+    }
+    // the content has been consumed, it is in the destination
+    callback_(error_code, result_t{copier_.content(), 0});
+}
+
+// Delivers the replies to the reply handler as soon as they are parsed
+// and consumes them, until the requested replies count is delivered (or
+// until error, when it is zero); the callback gets the count of the
+// delivered replies.
+template <typename NextLayer, typename DynamicBuffer, typename ReplyHandler,
+          typename ReadCallback, typename Policy>
+class async_dispatch_op {
+    NextLayer &stream_;
+    DynamicBuffer &rx_buff_;
+    ReplyHandler reply_handler_;
+    ReadCallback callback_;
+    std::shared_ptr<result_storage_t<Policy>> storage_;
+    std::size_t replies_count_;
+    std::size_t max_batch_;
+    std::size_t delivered_;
+
+    std::size_t batch_size() const {
+        return replies_count_
+                   ? std::min(max_batch_, replies_count_ - delivered_)
+                   : max_batch_;
+    }
+
+    /* delivers the parsed replies; returns true when the dispatching
+     * is finished */
+    bool dispatch(boost::system::error_code &error_code);
+
+  public:
+    async_dispatch_op(async_dispatch_op &&) = default;
+    async_dispatch_op(const async_dispatch_op &) = default;
+
+    template <class DeducedHandler, class DeducedReplyHandler>
+    async_dispatch_op(DeducedHandler &&deduced_handler, NextLayer &stream,
+                      DynamicBuffer &rx_buff,
+                      DeducedReplyHandler &&reply_handler,
+                      std::size_t replies_count, std::size_t max_batch)
+        : stream_(stream), rx_buff_(rx_buff),
+          reply_handler_(std::forward<DeducedReplyHandler>(reply_handler)),
+          callback_(std::forward<ReadCallback>(deduced_handler)),
+          storage_(std::make_shared<result_storage_t<Policy>>()),
+          replies_count_(replies_count),
+          max_batch_(std::max<std::size_t>(max_batch, 1)), delivered_(0) {
+        storage_->parser.reset(batch_size(), 0, max_batch_ > 1);
+    }
+
+    /* the already received data is dispatched first; neither the reply
+     * handler nor the callback is invoked from within */
+    void start();
+
+    void operator()(boost::system::error_code, std::size_t bytes_transferred);
+
+    friend bool asio_handler_is_continuation(async_dispatch_op *op) {
+        using boost::asio::asio_handler_is_continuation;
+        return asio_handler_is_continuation(std::addressof(op->callback_));
+    }
+
+    friend void *asio_handler_allocate(std::size_t size,
+                                       async_dispatch_op *op) {
+        using boost::asio::asio_handler_allocate;
+        return asio_handler_allocate(size, std::addressof(op->callback_));
+    }
+
+    friend void asio_handler_deallocate(void *p, std::size_t size,
+                                        async_dispatch_op *op) {
+        using boost::asio::asio_handler_deallocate;
+        return asio_handler_deallocate(p, size, std::addressof(op->callback_));
+    }
+
+    template <class Function>
+    friend void asio_handler_invoke(Function &&f, async_dispatch_op *op) {
+        using boost::asio::asio_handler_invoke;
+        return asio_handler_invoke(f, std::addressof(op->callback_));
+    }
+};
+
+template <typename NextLayer, typename DynamicBuffer, typename ReplyHandler,
+          typename ReadCallback, typename Policy>
+bool async_dispatch_op<NextLayer, DynamicBuffer, ReplyHandler, ReadCallback,
+                       Policy>::dispatch(boost::system::error_code
+                                             &error_code) {
+    auto &parser = storage_->parser;
+    auto &result = storage_->result;
+    while (!replies_count_ || delivered_ < replies_count_) {
+        // the incomplete reply after the delivered ones is not parsed
+        // again, the parser is rebased onto it
+        parser.advance_buffers(rx_buff_.data());
+        if (parser.error()) {
+            error_code = parser.error();
+            return true;
+        }
+        auto count = parser.replies_count();
+        if (!count) {
+            return false;
+        }
+        auto buffer = details::buffer_base<Policy>(rx_buff_.data());
+        parser.result(buffer, result);
+        reply_handler_(static_cast<const positive_parse_result_t<Policy> &>(
+            result));
+        rx_buff_.consume(result.consumed);
+        delivered_ += count;
+        parser.rebase(batch_size(), max_batch_ > 1);
+    }
+    return true;
+}
+
+template <typename NextLayer, typename DynamicBuffer, typename ReplyHandler,
+          typename ReadCallback, typename Policy>
+void async_dispatch_op<NextLayer, DynamicBuffer, ReplyHandler, ReadCallback,
+                       Policy>::start() {
+    auto size = details::stream_read_size(rx_buff_);
+    if (rx_buff_.size() || !size) {
+        // empty read just completes via the stream executor
+        stream_.async_read_some(boost::asio::mutable_buffer(),
+                                std::move(*this));
+    } else {
+        stream_.async_read_some(rx_buff_.prepare(size), std::move(*this));
+    }
+}
+
+template <typename NextLayer, typename DynamicBuffer, typename ReplyHandler,
+          typename ReadCallback, typename Policy>
+void async_dispatch_op<NextLayer, DynamicBuffer, ReplyHandler, ReadCallback,
+                       Policy>::operator()(boost::system::error_code
+                                               error_code,
+                                           std::size_t bytes_transferred) {
+    if (!error_code) {
+        rx_buff_.commit(bytes_transferred);
+        if (!dispatch(error_code)) {
+            // the consumed space is reused, i.e. the buffer does not grow
+            // with the pipeline depth
+            auto size = details::stream_read_size(rx_buff_);
+            if (size) {
+                stream_.async_read_some(rx_buff_.prepare(size),
+                                        std::move(*this));
+                return;
             }
+            error_code = boost::asio::error::not_found;
+        }
+    }
+    callback_(error_code, delivered_);
+}
+
+// Serializes the commands by windows of (at least) the given size; the
+// next window is serialized into the spare buffer, while the current one
+// is written, then the buffers are swapped. The written data is consumed,
+// i.e. the memory does not grow with the count of commands. The callback
+// gets the total bytes written.
+template <typename NextLayer, typename DynamicBuffer, typename WriteCallback>
+class async_write_op {
+    NextLayer &stream_;
+    DynamicBuffer &tx_buff_;
+    WriteCallback callback_;
+    const single_command_t *commands_;
+    std::size_t count_;
+    std::size_t window_size_;
+    std::size_t written_;
+    // the buffer of every other window, it is shared by the copies of
+    // the operation
+    std::shared_ptr<std::string> spare_;
+    // the window being written is in the spare buffer
+    bool from_spare_;
+    // the next window is serialized
+    bool ready_;
+
+    /* the commands count of the next window */
+    std::size_t window_count() const;
+    void write_window(bool from_spare);
+
+  public:
+    async_write_op(async_write_op &&) = default;
+    async_write_op(const async_write_op &) = default;
+
+    template <class DeducedHandler>
+    async_write_op(DeducedHandler &&deduced_handler, NextLayer &stream,
+                   DynamicBuffer &tx_buff, const single_command_t *commands,
+                   std::size_t count, std::size_t window_size)
+        : stream_(stream), tx_buff_(tx_buff),
+          callback_(std::forward<WriteCallback>(deduced_handler)),
+          commands_(commands), count_(count),
+          window_size_(std::max<std::size_t>(window_size, 1)), written_(0),
+          from_spare_(false), ready_(false) {}
+
+    /* serializes and writes the first window */
+    void start();
+
+    void operator()(boost::system::error_code, std::size_t bytes_transferred);
+
+    friend bool asio_handler_is_continuation(async_write_op *op) {
+        using boost::asio::asio_handler_is_continuation;
+        return asio_handler_is_continuation(std::addressof(op->callback_));
+    }
+
+    friend void *asio_handler_allocate(std::size_t size, async_write_op *op) {
+        using boost::asio::asio_handler_allocate;
+        return asio_handler_allocate(size, std::addressof(op->callback_));
+    }
+
+    friend void asio_handler_deallocate(void *p, std::size_t size,
+                                        async_write_op *op) {
+        using boost::asio::asio_handler_deallocate;
+        return asio_handler_deallocate(p, size, std::addressof(op->callback_));
+    }
+
+    template <class Function>
+    friend void asio_handler_invoke(Function &&f, async_write_op *op) {
+        using boost::asio::asio_handler_invoke;
+        return asio_handler_invoke(f, std::addressof(op->callback_));
+    }
+};
+
+template <typename NextLayer, typename DynamicBuffer, typename WriteCallback>
+std::size_t
+async_write_op<NextLayer, DynamicBuffer, WriteCallback>::window_count() const {
+    std::size_t size = 0;
+    std::size_t count = 0;
+    while (count < count_ && size < window_size_) {
+        size += details::serialized_size(commands_[count++]);
+    }
+    return count;
+}
+
+template <typename NextLayer, typename DynamicBuffer, typename WriteCallback>
+void async_write_op<NextLayer, DynamicBuffer, WriteCallback>::start() {
+    auto count = window_count();
+    details::serialize_commands(tx_buff_, commands_, count);
+    commands_ += count;
+    count_ -= count;
+    write_window(false);
+}
+
+template <typename NextLayer, typename DynamicBuffer, typename WriteCallback>
+void async_write_op<NextLayer, DynamicBuffer, WriteCallback>::write_window(
+    bool from_spare) {
+    namespace asio = boost::asio;
+    // the operation is moved into the write, so the next window is
+    // captured before, and it is serialized after the write is initiated
+    auto commands = commands_;
+    auto count = window_count();
+    if (count && !spare_) {
+        spare_ = std::make_shared<std::string>();
+    }
+    auto spare = spare_;
+    auto &tx_buff = tx_buff_;
+    commands_ += count;
+    count_ -= count;
+    ready_ = count != 0;
+    from_spare_ = from_spare;
+
+    if (from_spare) {
+        asio::async_write(stream_, asio::buffer(*spare), std::move(*this));
+        details::serialize_commands(tx_buff, commands, count);
+    } else {
+        asio::async_write(stream_, tx_buff.data(), std::move(*this));
+        if (count) {
+            auto spare_buff = asio::dynamic_buffer(*spare);
+            details::serialize_commands(spare_buff, commands, count);
         }
     }
+}
 
-    callback_(error_code, std::move(result));
+template <typename NextLayer, typename DynamicBuffer, typename WriteCallback>
+void async_write_op<NextLayer, DynamicBuffer, WriteCallback>::operator()(
+    boost::system::error_code error_code, std::size_t bytes_transferred) {
+    written_ += bytes_transferred;
+    if (from_spare_) {
+        spare_->clear();
+    } else {
+        tx_buff_.consume(bytes_transferred);
+    }
+    if (!error_code && ready_) {
+        write_window(!from_spare_);
+        return;
+    }
+    callback_(error_code, written_);
 }
 
 } // namespace bredis
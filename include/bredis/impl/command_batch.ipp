@@ -0,0 +1,79 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+#pragma once
+
+#include <charconv>
+#include <cstring>
+
+namespace bredis {
+
+namespace details {
+
+template <typename T>
+std::string_view format_argument(const T &value, number_buffer_t &number,
+                                 std::string &scratch) {
+    if constexpr (std::is_convertible<const T &, std::string_view>::value) {
+        return value;
+    } else if constexpr (std::is_convertible<const T &,
+                                             boost::asio::const_buffer>::value) {
+        boost::asio::const_buffer buffer(value);
+        return {static_cast<const char *>(buffer.data()), buffer.size()};
+    } else if constexpr (std::is_arithmetic<T>::value) {
+        auto end = std::to_chars(number.data(), number.data() + number.size(),
+                                 value)
+                       .ptr;
+        return {number.data(), static_cast<std::size_t>(end - number.data())};
+    } else {
+        scratch.clear();
+        bredis_format(scratch, value);
+        return scratch;
+    }
+}
+
+} // namespace details
+
+void command_batch_t::append_header(char introduction, std::size_t value) {
+    auto offset = encoded_.size();
+    encoded_.resize(offset + details::header_size(value));
+    details::write_header(&encoded_[offset], introduction, value);
+}
+
+template <typename T> void command_batch_t::append_argument(const T &value) {
+    details::number_buffer_t number;
+    auto bytes = details::format_argument(value, number, scratch_);
+    append_header('$', bytes.size());
+    encoded_.append(bytes);
+    encoded_.append(terminator);
+}
+
+command_batch_t &command_batch_t::add(const single_command_t &cmd) {
+    auto offset = encoded_.size();
+    encoded_.resize(offset + details::serialized_size(cmd));
+    details::write_command(&encoded_[offset], cmd);
+    ++commands_;
+    replies_ += replying_;
+    return *this;
+}
+
+command_batch_t &command_batch_t::reply_off() {
+    if (replying_) {
+        encode("CLIENT", "REPLY", "OFF");
+        replying_ = false;
+    }
+    return *this;
+}
+
+command_batch_t &command_batch_t::reply_on() {
+    if (!replying_) {
+        encode("CLIENT", "REPLY", "ON");
+        ++replies_;
+        replying_ = true;
+    }
+    return *this;
+}
+
+} // namespace bredis
@@ -6,10 +6,12 @@
 //
 #pragma once
 
+#include <algorithm>
 #include <iostream>
-#include <locale>
-#include <sstream>
 #include <string>
+#include <type_traits>
+
+#include <boost/asio.hpp>
 
 #ifdef BREDIS_DEBUG
 #define BREDIS_LOG_DEBUG(msg)                                                  \
@@ -20,17 +22,6 @@
 
 namespace bredis {
 
-struct consumed_parse {
-	template <typename Policy>
-    int operator()(const positive_parse_result_t<Policy> &value) const {
-        return static_cast<int>(value.consumed);
-    }
-
-    int operator()(const not_enough_data_t &value) const { return 0; }
-
-    int operator()(const protocol_error_t &value) const { return -1; }
-};
-
 // todo:  change to std::basic_string_view<charT> in C++17
 template <typename charT> using basic_string_view_type = std::basic_string_view<charT>;
 
@@ -51,73 +42,140 @@ inline constexpr auto make_string_view( _It begin, _It end )
      };
 }   // make_string_view
 
-template <typename Iterator> class MatchResult {
-  private:
-    std::size_t matched_results_;
-    std::size_t expected_count_;
-
-  public:
-    MatchResult(std::size_t expected_count)
-        : expected_count_(expected_count), matched_results_(0) {}
-
-    std::pair<Iterator, bool> operator()(Iterator begin, Iterator end) {
-        using Policy = bredis::parsing_policy::drop_result;
-
-        auto parsing_complete = false;
-        size_t consumed = 0;
-        auto parse_from = begin;
-        do {
-            auto from = parse_from;
-            auto view = make_string_view(begin, end);
-            auto parse_result = Protocol::parse<Policy>(view);
-            auto consumable = std::visit(
-                consumed_parse(), parse_result);
-            if (consumable == -1) {
-                // parse error
-                consumed = 0;
-                parsing_complete = true;
-                break;
-            }
-            if (consumable == 0) {
-                // no enough data
-                break;
-            }
-            ++matched_results_;
-            auto iteration_consumed = static_cast<std::size_t>(consumable);
-            consumed += iteration_consumed;
-            parse_from += iteration_consumed;
-            parsing_complete = (matched_results_ == expected_count_);
-        } while (!parsing_complete);
-        return std::make_pair(begin + consumed, parsing_complete);
+namespace details {
+
+// bytes to be prepared for the next read, the same as asio does for
+// read_until; zero means the buffer is full
+template <typename DynamicBuffer>
+std::size_t read_size(const DynamicBuffer &rx_buff) {
+    constexpr std::size_t min_size = 512;
+    constexpr std::size_t max_size = 65536;
+    auto size = rx_buff.size();
+    auto free_size = rx_buff.max_size() - size;
+    return std::min(std::max(min_size, rx_buff.capacity() - size),
+                    std::min(max_size, free_size));
+}
+
+// the same for streaming, when the received data is consumed right away,
+// i.e. the capacity does not grow on its own
+template <typename DynamicBuffer>
+std::size_t stream_read_size(const DynamicBuffer &rx_buff) {
+    constexpr std::size_t max_size = 65536;
+    return std::min(max_size, rx_buff.max_size() - rx_buff.size());
+}
+
+// The start of the received data, when it is contiguous; otherwise the
+// data is accessible only via tape offsets.
+template <typename Policy, typename ConstBufferSequence>
+const char *buffer_base(const ConstBufferSequence &buffers) {
+    namespace asio = boost::asio;
+    if constexpr (std::is_convertible<ConstBufferSequence,
+                                      asio::const_buffer>::value) {
+        return static_cast<const char *>(asio::const_buffer(buffers).data());
+    } else {
+        static_assert(
+            !std::is_same<Policy, parsing_policy::keep_result>::value,
+            "non-contiguous buffers require tape_result parsing policy");
+        auto it = asio::buffer_sequence_begin(buffers);
+        if (it == asio::buffer_sequence_end(buffers)) {
+            return nullptr;
+        }
+        asio::const_buffer first(*it);
+        return first.size() == asio::buffer_size(buffers)
+                   ? static_cast<const char *>(first.data())
+                   : nullptr;
+    }
+}
+
+// Reads from the stream into the buffer until the expected replies are
+// parsed; the already received data is parsed first.
+template <typename SyncReadStream, typename DynamicBuffer, typename Parser>
+void read_replies(SyncReadStream &stream, DynamicBuffer &rx_buff,
+                  Parser &parser, boost::system::error_code &ec) {
+    parser.advance_buffers(rx_buff.data());
+    while (!parser.complete()) {
+        auto size = read_size(rx_buff);
+        if (!size) {
+            ec = boost::asio::error::not_found;
+            return;
+        }
+        auto bytes_transferred = stream.read_some(rx_buff.prepare(size), ec);
+        if (ec) {
+            return;
+        }
+        rx_buff.commit(bytes_transferred);
+        parser.advance_buffers(rx_buff.data());
     }
-};
-
-class command_serializer_visitor {
-  public:
-    std::string operator()(const single_command_t &value) const {
-        std::stringstream out;
-        out.imbue(std::locale::classic());
-        Protocol::serialize(out, value);
-        return out.str();
+    if (parser.error()) {
+        ec = parser.error();
     }
+}
 
-    std::string operator()(const command_container_t &value) const {
-        std::stringstream out;
-        out.imbue(std::locale::classic());
-        for (const auto &cmd : value) {
-            Protocol::serialize(out, cmd);
+// Reads from the stream into the buffer, consuming the streamed data,
+// until the stream state (bulk_stream_t or aggregate_stream_t) is
+// complete; the already received data is examined first.
+template <typename SyncReadStream, typename DynamicBuffer, typename Stream,
+          typename Callback>
+void read_streamed(SyncReadStream &stream, DynamicBuffer &rx_buff,
+                   Stream &stream_state, Callback &callback,
+                   boost::system::error_code &ec) {
+    rx_buff.consume(stream_state.advance(rx_buff.data(), callback));
+    while (!stream_state.complete()) {
+        auto size = stream_read_size(rx_buff);
+        if (!size) {
+            ec = boost::asio::error::not_found;
+            return;
         }
-        return out.str();
+        auto bytes_transferred = stream.read_some(rx_buff.prepare(size), ec);
+        if (ec) {
+            return;
+        }
+        rx_buff.commit(bytes_transferred);
+        rx_buff.consume(stream_state.advance(rx_buff.data(), callback));
+    }
+    if (stream_state.error()) {
+        ec = stream_state.error();
     }
-};
+}
 
-} // namespace bredis
+// Reads the bulk string into the destination via the copier (see
+// bulk_copier_t): the already received part of it is copied from the
+// buffer, and the rest is read right into the destination, when it fits.
+template <typename SyncReadStream, typename DynamicBuffer, typename Stream,
+          typename Copier>
+void read_into(SyncReadStream &stream, DynamicBuffer &rx_buff,
+               Stream &stream_state, Copier &copier,
+               boost::system::error_code &ec) {
+    rx_buff.consume(stream_state.advance(rx_buff.data(), copier));
+    while (!stream_state.complete()) {
+        auto left = stream_state.left();
+        if (left && copier.fits(stream_state.size())) {
+            auto bytes_transferred =
+                boost::asio::read(stream, copier.rest(left), ec);
+            if (ec) {
+                return;
+            }
+            copier.copied += bytes_transferred;
+            stream_state.skip(bytes_transferred);
+            continue;
+        }
+        auto size = stream_read_size(rx_buff);
+        if (!size) {
+            ec = boost::asio::error::not_found;
+            return;
+        }
+        auto bytes_transferred = stream.read_some(rx_buff.prepare(size), ec);
+        if (ec) {
+            return;
+        }
+        rx_buff.commit(bytes_transferred);
+        rx_buff.consume(stream_state.advance(rx_buff.data(), copier));
+    }
+    if (stream_state.error()) {
+        ec = stream_state.error();
+    }
+}
 
-namespace boost {
-namespace asio {
+} // namespace details
 
-template <typename Iterator>
-struct is_match_condition<bredis::MatchResult<Iterator>>
-    : public std::true_type {};
-}
-}
+} // namespace bredis
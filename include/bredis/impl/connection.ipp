@@ -30,51 +30,279 @@ Connection<NextLayer>::async_write(DynamicBuffer &tx_buff,
     using real_handler_t =
         typename asio::handler_type<WriteCallback, Signature>::type;
 
-    std::ostream os(&tx_buff);
-    auto string = std::visit(command_serializer_visitor(), command);
-    os.write(string.c_str(), string.size());
+    // the only copy of the arguments is into the buffer
+    Protocol::serialize_into(tx_buff, command);
 
     real_handler_t handler(std::forward<WriteCallback>(write_callback));
     return async_write(stream_, tx_buff, handler);
 }
 
 template <typename NextLayer>
-template <typename DynamicBuffer, typename ReadCallback>
+template <typename WriteCallback>
+BOOST_ASIO_INITFN_RESULT_TYPE(WriteCallback,
+                              void(boost::system::error_code, std::size_t))
+Connection<NextLayer>::async_write(const command_wrapper_t &command,
+                                   WriteCallback &&write_callback) {
+    namespace asio = boost::asio;
+    using boost::asio::async_write;
+    using Signature = void(boost::system::error_code, std::size_t);
+    using real_handler_t =
+        typename asio::handler_type<WriteCallback, Signature>::type;
+
+    // the buffers (and the headers they own) are kept by the operation
+    command_buffers_t buffers(command);
+    real_handler_t handler(std::forward<WriteCallback>(write_callback));
+    return async_write(stream_, buffers, handler);
+}
+
+template <typename NextLayer>
+template <typename DynamicBuffer, typename EncodedCommand,
+          typename WriteCallback, typename>
+BOOST_ASIO_INITFN_RESULT_TYPE(WriteCallback,
+                              void(boost::system::error_code, std::size_t))
+Connection<NextLayer>::async_write(DynamicBuffer &tx_buff,
+                                   const EncodedCommand &command,
+                                   WriteCallback &&write_callback) {
+    namespace asio = boost::asio;
+    using boost::asio::async_write;
+    using Signature = void(boost::system::error_code, std::size_t);
+    using real_handler_t =
+        typename asio::handler_type<WriteCallback, Signature>::type;
+
+    tx_buff.commit(asio::buffer_copy(tx_buff.prepare(command.size()),
+                                     command.buffers()));
+    real_handler_t handler(std::forward<WriteCallback>(write_callback));
+    return async_write(stream_, tx_buff, handler);
+}
+
+template <typename NextLayer>
+template <typename EncodedCommand, typename WriteCallback, typename>
+BOOST_ASIO_INITFN_RESULT_TYPE(WriteCallback,
+                              void(boost::system::error_code, std::size_t))
+Connection<NextLayer>::async_write(const EncodedCommand &command,
+                                   WriteCallback &&write_callback) {
+    namespace asio = boost::asio;
+    using boost::asio::async_write;
+    using Signature = void(boost::system::error_code, std::size_t);
+    using real_handler_t =
+        typename asio::handler_type<WriteCallback, Signature>::type;
+
+    real_handler_t handler(std::forward<WriteCallback>(write_callback));
+    return async_write(stream_, command.buffers(), handler);
+}
+
+template <typename NextLayer>
+template <typename DynamicBuffer, typename WriteCallback>
+BOOST_ASIO_INITFN_RESULT_TYPE(WriteCallback,
+                              void(boost::system::error_code, std::size_t))
+Connection<NextLayer>::async_write_windowed(DynamicBuffer &tx_buff,
+                                            const command_container_t &commands,
+                                            WriteCallback &&write_callback,
+                                            std::size_t window_size) {
+    namespace asio = boost::asio;
+    using Signature = void(boost::system::error_code, std::size_t);
+    using real_handler_t =
+        typename asio::handler_type<WriteCallback, Signature>::type;
+
+    real_handler_t real_handler(std::forward<WriteCallback>(write_callback));
+    asio::async_result<real_handler_t> async_result(real_handler);
+
+    async_write_op<NextLayer, DynamicBuffer, real_handler_t> async_op(
+        std::move(real_handler), stream_, tx_buff, commands.data(),
+        commands.size(), window_size);
+    async_op.start();
+    return async_result.get();
+}
+
+template <typename NextLayer>
+template <typename Policy, typename DynamicBuffer, typename ReadCallback>
 BOOST_ASIO_INITFN_RESULT_TYPE(ReadCallback,
-                              void(const boost::system::error_code,
-                                   BREDIS_PARSE_RESULT(DynamicBuffer)))
+                              void(boost::system::error_code,
+                                   positive_parse_result_t<Policy>))
 Connection<NextLayer>::async_read(DynamicBuffer &rx_buff,
                                   ReadCallback &&read_callback,
-                                  std::size_t replies_count) {
+                                  std::size_t replies_count,
+                                  std::size_t offset) {
 
     namespace asio = boost::asio;
     namespace sys = boost::system;
-    using boost::asio::async_read_until;
-    using Iterator = typename to_iterator<DynamicBuffer>::iterator_t;
     using Signature =
-        void(boost::system::error_code, BREDIS_PARSE_RESULT(DynamicBuffer));
+        void(boost::system::error_code, positive_parse_result_t<Policy>);
+    using real_handler_t =
+        typename asio::handler_type<ReadCallback, Signature>::type;
+    using result_t = ::boost::asio::async_result<real_handler_t>;
+
+    real_handler_t real_handler(std::forward<ReadCallback>(read_callback));
+    asio::async_result<real_handler_t> async_result(real_handler);
+
+    auto storage =
+        std::make_shared<result_storage_t<Policy>>(replies_count, offset);
+    async_read_op<NextLayer, DynamicBuffer, real_handler_t, Policy> async_op(
+        std::move(real_handler), stream_, rx_buff, std::move(storage));
+
+    async_op.start();
+    return async_result.get();
+}
+
+template <typename NextLayer>
+template <typename Policy, typename DynamicBuffer, typename ReadCallback>
+BOOST_ASIO_INITFN_RESULT_TYPE(ReadCallback,
+                              void(boost::system::error_code,
+                                   positive_parse_result_t<Policy> &))
+Connection<NextLayer>::async_read(DynamicBuffer &rx_buff,
+                                  result_storage_t<Policy> &storage,
+                                  ReadCallback &&read_callback,
+                                  std::size_t replies_count,
+                                  std::size_t offset) {
+
+    namespace asio = boost::asio;
+    using Signature =
+        void(boost::system::error_code, positive_parse_result_t<Policy> &);
+    using real_handler_t =
+        typename asio::handler_type<ReadCallback, Signature>::type;
+    using result_t = ::boost::asio::async_result<real_handler_t>;
+
+    real_handler_t real_handler(std::forward<ReadCallback>(read_callback));
+    asio::async_result<real_handler_t> async_result(real_handler);
+
+    storage.parser.reset(replies_count, offset);
+    async_read_op<NextLayer, DynamicBuffer, real_handler_t, Policy,
+                  result_storage_t<Policy> *>
+        async_op(std::move(real_handler), stream_, rx_buff, &storage);
+
+    async_op.start();
+    return async_result.get();
+}
+
+template <typename NextLayer>
+template <typename DynamicBuffer, typename ChunkCallback,
+          typename ReadCallback>
+BOOST_ASIO_INITFN_RESULT_TYPE(
+    ReadCallback,
+    void(boost::system::error_code,
+         positive_parse_result_t<parsing_policy::keep_result>))
+Connection<NextLayer>::async_read_stream(DynamicBuffer &rx_buff,
+                                         ChunkCallback &&chunk_callback,
+                                         ReadCallback &&read_callback) {
+
+    namespace asio = boost::asio;
+    using Signature =
+        void(boost::system::error_code,
+             positive_parse_result_t<parsing_policy::keep_result>);
     using real_handler_t =
         typename asio::handler_type<ReadCallback, Signature>::type;
     using result_t = ::boost::asio::async_result<real_handler_t>;
+    using chunk_callback_t = typename std::decay<ChunkCallback>::type;
 
     real_handler_t real_handler(std::forward<ReadCallback>(read_callback));
     asio::async_result<real_handler_t> async_result(real_handler);
 
-    async_read_op<NextLayer, DynamicBuffer, real_handler_t> async_op(
-        std::move(real_handler), stream_, rx_buff, replies_count);
+    async_stream_op<NextLayer, DynamicBuffer, bulk_stream_t,
+                    chunk_callback_t, real_handler_t>
+        async_op(std::move(real_handler), stream_, rx_buff, bulk_stream_t{},
+                 std::forward<ChunkCallback>(chunk_callback));
 
-    async_read_until(stream_, rx_buff, MatchResult<Iterator>(replies_count),
-                     std::move(async_op));
+    async_op.start();
+    return async_result.get();
+}
+
+template <typename NextLayer>
+template <typename DynamicBuffer, typename ReadCallback>
+BOOST_ASIO_INITFN_RESULT_TYPE(
+    ReadCallback,
+    void(boost::system::error_code,
+         positive_parse_result_t<parsing_policy::keep_result>))
+Connection<NextLayer>::async_read_into(DynamicBuffer &rx_buff,
+                                       boost::asio::mutable_buffer destination,
+                                       ReadCallback &&read_callback) {
+
+    namespace asio = boost::asio;
+    using Signature =
+        void(boost::system::error_code,
+             positive_parse_result_t<parsing_policy::keep_result>);
+    using real_handler_t =
+        typename asio::handler_type<ReadCallback, Signature>::type;
+    using result_t = ::boost::asio::async_result<real_handler_t>;
+
+    real_handler_t real_handler(std::forward<ReadCallback>(read_callback));
+    asio::async_result<real_handler_t> async_result(real_handler);
+
+    async_read_into_op<NextLayer, DynamicBuffer, real_handler_t> async_op(
+        std::move(real_handler), stream_, rx_buff, destination);
+
+    async_op.start();
+    return async_result.get();
+}
+
+template <typename NextLayer>
+template <typename DynamicBuffer, typename ElementCallback,
+          typename ReadCallback>
+BOOST_ASIO_INITFN_RESULT_TYPE(
+    ReadCallback,
+    void(boost::system::error_code,
+         positive_parse_result_t<parsing_policy::keep_result>))
+Connection<NextLayer>::async_read_elements(DynamicBuffer &rx_buff,
+                                           ElementCallback &&element_callback,
+                                           ReadCallback &&read_callback,
+                                           std::size_t depth) {
+
+    namespace asio = boost::asio;
+    using Signature =
+        void(boost::system::error_code,
+             positive_parse_result_t<parsing_policy::keep_result>);
+    using real_handler_t =
+        typename asio::handler_type<ReadCallback, Signature>::type;
+    using result_t = ::boost::asio::async_result<real_handler_t>;
+    using element_callback_t = typename std::decay<ElementCallback>::type;
+
+    real_handler_t real_handler(std::forward<ReadCallback>(read_callback));
+    asio::async_result<real_handler_t> async_result(real_handler);
+
+    async_stream_op<NextLayer, DynamicBuffer, aggregate_stream_t,
+                    element_callback_t, real_handler_t>
+        async_op(std::move(real_handler), stream_, rx_buff,
+                 aggregate_stream_t(depth),
+                 std::forward<ElementCallback>(element_callback));
+
+    async_op.start();
+    return async_result.get();
+}
+
+template <typename NextLayer>
+template <typename Policy, typename DynamicBuffer, typename ReplyHandler,
+          typename ReadCallback>
+BOOST_ASIO_INITFN_RESULT_TYPE(ReadCallback,
+                              void(boost::system::error_code, std::size_t))
+Connection<NextLayer>::async_dispatch(DynamicBuffer &rx_buff,
+                                      ReplyHandler &&reply_handler,
+                                      ReadCallback &&read_callback,
+                                      std::size_t replies_count,
+                                      std::size_t max_batch) {
+
+    namespace asio = boost::asio;
+    using Signature = void(boost::system::error_code, std::size_t);
+    using real_handler_t =
+        typename asio::handler_type<ReadCallback, Signature>::type;
+    using result_t = ::boost::asio::async_result<real_handler_t>;
+    using reply_handler_t = typename std::decay<ReplyHandler>::type;
+
+    real_handler_t real_handler(std::forward<ReadCallback>(read_callback));
+    asio::async_result<real_handler_t> async_result(real_handler);
+
+    async_dispatch_op<NextLayer, DynamicBuffer, reply_handler_t,
+                      real_handler_t, Policy>
+        async_op(std::move(real_handler), stream_, rx_buff,
+                 std::forward<ReplyHandler>(reply_handler), replies_count,
+                 max_batch);
+
+    async_op.start();
     return async_result.get();
 }
 
 template <typename NextLayer>
 void Connection<NextLayer>::write(const command_wrapper_t &command,
                                   boost::system::error_code &ec) {
-    namespace asio = boost::asio;
-    auto str = std::visit(command_serializer_visitor(), command);
-    auto const output_buf = asio::buffer(str.c_str(), str.size());
-    asio::write(stream_, output_buf, ec);
+    boost::asio::write(stream_, command_buffers_t(command), ec);
 }
 
 template <typename NextLayer>
@@ -87,39 +315,185 @@ void Connection<NextLayer>::write(const command_wrapper_t &command) {
 }
 
 template <typename NextLayer>
-template <typename DynamicBuffer>
-BREDIS_PARSE_RESULT(DynamicBuffer)
+template <typename EncodedCommand, typename>
+void Connection<NextLayer>::write(const EncodedCommand &command,
+                                  boost::system::error_code &ec) {
+    boost::asio::write(stream_, command.buffers(), ec);
+}
+
+template <typename NextLayer>
+template <typename EncodedCommand, typename>
+void Connection<NextLayer>::write(const EncodedCommand &command) {
+    boost::system::error_code ec;
+    this->write(command, ec);
+    if (ec) {
+        throw boost::system::system_error{ec};
+    }
+}
+
+template <typename NextLayer>
+template <typename Policy, typename DynamicBuffer>
+positive_parse_result_t<Policy>
 Connection<NextLayer>::read(DynamicBuffer &rx_buff,
                             boost::system::error_code &ec) {
     namespace asio = boost::asio;
-    using boost::asio::read_until;
-    using Iterator = typename to_iterator<DynamicBuffer>::iterator_t;
-    using result_t = BREDIS_PARSE_RESULT(DynamicBuffer);
+    using result_t = positive_parse_result_t<Policy>;
 
-    auto rx_bytes = read_until(stream_, rx_buff, MatchResult<Iterator>(1), ec);
+    ResumableParser<Policy> parser;
+    details::read_replies(stream_, rx_buff, parser, ec);
     if (ec) {
-        return result_t{{}, 0};
+        return result_t{};
     }
 
-	std::string_view view(boost::asio::buffer_cast<const char*>(rx_buff.data()), rx_buff.size());
+    return parser.result(details::buffer_base<Policy>(rx_buff.data()));
+}
 
-    auto parse_result = Protocol::parse(view);
+template <typename NextLayer>
+template <typename Policy, typename DynamicBuffer>
+positive_parse_result_t<Policy> &
+Connection<NextLayer>::read(DynamicBuffer &rx_buff,
+                            result_storage_t<Policy> &storage,
+                            boost::system::error_code &ec,
+                            std::size_t replies_count) {
+    namespace asio = boost::asio;
 
-    if (auto *parse_error = std::get_if<protocol_error_t>(&parse_result); parse_error) {
-        ec = *parse_error;
-        return result_t{};
+    auto &parser = storage.parser;
+    auto &result = storage.result;
+    result.consumed = 0;
+    parser.reset(replies_count);
+    details::read_replies(stream_, rx_buff, parser, ec);
+    if (!ec) {
+        parser.result(details::buffer_base<Policy>(rx_buff.data()), result);
     }
-    return std::get<result_t>(parse_result);
+    return result;
 }
 
 template <typename NextLayer>
-template <typename DynamicBuffer>
-BREDIS_PARSE_RESULT(DynamicBuffer)
+template <typename Policy, typename DynamicBuffer>
+positive_parse_result_t<Policy> &
+Connection<NextLayer>::read(DynamicBuffer &rx_buff,
+                            result_storage_t<Policy> &storage,
+                            std::size_t replies_count) {
+    boost::system::error_code ec;
+    auto &result = this->read(rx_buff, storage, ec, replies_count);
+    if (ec) {
+        throw boost::system::system_error{ec};
+    }
+    return result;
+}
+
+template <typename NextLayer>
+template <typename Policy, typename DynamicBuffer>
+positive_parse_result_t<Policy>
 Connection<NextLayer>::read(DynamicBuffer &rx_buff) {
     namespace asio = boost::asio;
 
     boost::system::error_code ec;
-    auto result = this->read(rx_buff, ec);
+    auto result = this->template read<Policy>(rx_buff, ec);
+    if (ec) {
+        throw boost::system::system_error{ec};
+    }
+    return result;
+}
+
+template <typename NextLayer>
+template <typename DynamicBuffer, typename Stream, typename Callback>
+positive_parse_result_t<parsing_policy::keep_result>
+Connection<NextLayer>::read_streamed(DynamicBuffer &rx_buff, Stream &stream,
+                                     Callback &callback,
+                                     boost::system::error_code &ec) {
+    using result_t = positive_parse_result_t<parsing_policy::keep_result>;
+
+    details::read_streamed(stream_, rx_buff, stream, callback, ec);
+    if (ec) {
+        return result_t{};
+    } else if (stream.not_streamed()) {
+        return this->read(rx_buff, ec);
+    }
+    // the content has been delivered and consumed
+    return result_t{stream.streamed_marker(), 0};
+}
+
+template <typename NextLayer>
+template <typename DynamicBuffer, typename ChunkCallback>
+positive_parse_result_t<parsing_policy::keep_result>
+Connection<NextLayer>::read_stream(DynamicBuffer &rx_buff,
+                                   ChunkCallback &&chunk_callback,
+                                   boost::system::error_code &ec) {
+    bulk_stream_t stream;
+    return read_streamed(rx_buff, stream, chunk_callback, ec);
+}
+
+template <typename NextLayer>
+template <typename DynamicBuffer, typename ChunkCallback>
+positive_parse_result_t<parsing_policy::keep_result>
+Connection<NextLayer>::read_stream(DynamicBuffer &rx_buff,
+                                   ChunkCallback &&chunk_callback) {
+    boost::system::error_code ec;
+    auto result = this->read_stream(
+        rx_buff, std::forward<ChunkCallback>(chunk_callback), ec);
+    if (ec) {
+        throw boost::system::system_error{ec};
+    }
+    return result;
+}
+
+template <typename NextLayer>
+template <typename DynamicBuffer>
+positive_parse_result_t<parsing_policy::keep_result>
+Connection<NextLayer>::read_into(DynamicBuffer &rx_buff,
+                                 boost::asio::mutable_buffer destination,
+                                 boost::system::error_code &ec) {
+    using result_t = positive_parse_result_t<parsing_policy::keep_result>;
+
+    bulk_stream_t stream;
+    details::bulk_copier_t copier{destination};
+    details::read_into(stream_, rx_buff, stream, copier, ec);
+    if (ec) {
+        return result_t{};
+    } else if (stream.not_streamed()) {
+        return this->read(rx_buff, ec);
+    } else if (!copier.fits(stream.size())) {
+        ec = Error::make_error_code(bredis_errors::destination_size);
+        return result_t{};
+    }
+    // the content has been consumed, it is in the destination
+    return result_t{copier.content(), 0};
+}
+
+template <typename NextLayer>
+template <typename DynamicBuffer>
+positive_parse_result_t<parsing_policy::keep_result>
+Connection<NextLayer>::read_into(DynamicBuffer &rx_buff,
+                                 boost::asio::mutable_buffer destination) {
+    boost::system::error_code ec;
+    auto result = this->read_into(rx_buff, destination, ec);
+    if (ec) {
+        throw boost::system::system_error{ec};
+    }
+    return result;
+}
+
+template <typename NextLayer>
+template <typename DynamicBuffer, typename ElementCallback>
+positive_parse_result_t<parsing_policy::keep_result>
+Connection<NextLayer>::read_elements(DynamicBuffer &rx_buff,
+                                     ElementCallback &&element_callback,
+                                     boost::system::error_code &ec,
+                                     std::size_t depth) {
+    aggregate_stream_t stream(depth);
+    return read_streamed(rx_buff, stream, element_callback, ec);
+}
+
+template <typename NextLayer>
+template <typename DynamicBuffer, typename ElementCallback>
+positive_parse_result_t<parsing_policy::keep_result>
+Connection<NextLayer>::read_elements(DynamicBuffer &rx_buff,
+                                     ElementCallback &&element_callback,
+                                     std::size_t depth) {
+    boost::system::error_code ec;
+    auto result = this->read_elements(
+        rx_buff, std::forward<ElementCallback>(element_callback), ec, depth);
     if (ec) {
         throw boost::system::system_error{ec};
     }
@@ -0,0 +1,128 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+#pragma once
+
+#include <variant>
+
+namespace bredis {
+
+template <typename NextLayer>
+bool CorkedWriter<NextLayer>::full(const batch_t &batch) const {
+    return (options_.max_bytes && batch.data.size() >= options_.max_bytes) ||
+           (options_.max_commands && batch.commands >= options_.max_commands);
+}
+
+template <typename NextLayer>
+bool CorkedWriter<NextLayer>::fits(const batch_t &batch, std::size_t size,
+                                   std::size_t commands) const {
+    if (!batch.commands) {
+        // the command larger than the limits is written on its own
+        return true;
+    }
+    return (!options_.max_bytes ||
+            batch.data.size() + size <= options_.max_bytes) &&
+           (!options_.max_commands ||
+            batch.commands + commands <= options_.max_commands);
+}
+
+template <typename NextLayer>
+typename CorkedWriter<NextLayer>::batch_t &
+CorkedWriter<NextLayer>::open_batch(std::size_t size, std::size_t commands) {
+    bool in_write = writing_ && batches_.size() == 1;
+    if (batches_.empty() || in_write ||
+        !fits(*batches_.back(), size, commands)) {
+        if (spare_.empty()) {
+            batches_.push_back(std::make_unique<batch_t>());
+        } else {
+            batches_.push_back(std::move(spare_.back()));
+            spare_.pop_back();
+        }
+    }
+    return *batches_.back();
+}
+
+template <typename NextLayer>
+void CorkedWriter<NextLayer>::options(const cork_options_t &options) {
+    options_ = options;
+    if (options_.linger.count() && !timer_) {
+        timer_.emplace(stream_.get_executor());
+    }
+}
+
+template <typename NextLayer>
+void CorkedWriter<NextLayer>::async_write(const command_wrapper_t &command,
+                                          callback_t callback) {
+    auto *container = std::get_if<command_container_t>(&command);
+    std::size_t commands = container ? container->size() : 1;
+    auto &batch = open_batch(Protocol::serialized_size(command), commands);
+    auto size = Protocol::serialize_into(batch.data, command);
+    batch.commands += commands;
+    if (callback) {
+        batch.callbacks.emplace_back(size, std::move(callback));
+    }
+
+    if (writing_) {
+        // written as soon as the previous batch is written
+        return;
+    }
+    // the batch is not written on its own, until it is full or the next
+    // command does not fit into it
+    bool filled = full(batch) || batches_.size() > 1;
+    if (lingering_) {
+        if (!filled) {
+            return;
+        }
+        lingering_ = false;
+        timer_->cancel();
+    } else if (options_.linger.count() && !filled) {
+        lingering_ = true;
+        timer_->expires_after(options_.linger);
+        timer_->async_wait([this](const boost::system::error_code &ec) {
+            if (ec == boost::asio::error::operation_aborted || !lingering_) {
+                return;
+            }
+            lingering_ = false;
+            write_front();
+        });
+        return;
+    }
+    write_front();
+}
+
+template <typename NextLayer> void CorkedWriter<NextLayer>::write_front() {
+    writing_ = true;
+    boost::asio::async_write(
+        stream_, batches_.front()->data.data(),
+        [this](const boost::system::error_code &ec, std::size_t) {
+            writing_ = false;
+            auto batch = std::move(batches_.front());
+            batches_.pop_front();
+            // the callbacks might write the next commands
+            for (auto &item : batch->callbacks) {
+                item.second(ec, item.first);
+            }
+            batch->data.consume(batch->data.size());
+            batch->commands = 0;
+            batch->callbacks.clear();
+            spare_.push_back(std::move(batch));
+
+            if (!writing_ && !lingering_ && !batches_.empty()) {
+                write_front();
+            }
+        });
+}
+
+template <typename NextLayer>
+std::size_t CorkedWriter<NextLayer>::queued() const {
+    std::size_t size = 0;
+    for (const auto &batch : batches_) {
+        size += batch->data.size();
+    }
+    return size;
+}
+
+} // namespace bredis
@@ -0,0 +1,306 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <iterator>
+
+namespace bredis {
+
+namespace details {
+
+inline bool equal_nocase(std::string_view a, std::string_view b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](const char x, const char y) {
+                          return std::toupper(static_cast<unsigned char>(x)) ==
+                                 std::toupper(static_cast<unsigned char>(y));
+                      });
+}
+
+// the index of the kind is the one of confirmation_t, the subscriptions
+// go first
+constexpr std::string_view subscription_kinds[] = {
+    "subscribe",   "psubscribe",   "ssubscribe",
+    "unsubscribe", "punsubscribe", "sunsubscribe"};
+
+inline std::optional<std::size_t> subscription_index(std::string_view name) {
+    for (std::size_t i = 0; i < std::size(subscription_kinds); ++i) {
+        if (equal_nocase(name, subscription_kinds[i])) {
+            return i;
+        }
+    }
+    return {};
+}
+
+inline bool is_subscription_kind(std::string_view name) {
+    return subscription_index(name).has_value();
+}
+
+std::size_t replies_of(const single_command_t &cmd, reply_mode_t &mode) {
+    const auto &args = cmd.arguments;
+    if (args.size() == 3 && equal_nocase(args[0], "client") &&
+        equal_nocase(args[1], "reply")) {
+        if (equal_nocase(args[2], "on")) {
+            mode = reply_mode_t::on;
+            return 1;
+        } else if (equal_nocase(args[2], "off")) {
+            mode = reply_mode_t::off;
+            return 0;
+        } else if (equal_nocase(args[2], "skip")) {
+            if (mode == reply_mode_t::on) {
+                mode = reply_mode_t::skip;
+            }
+            return 0;
+        }
+    }
+    if (mode == reply_mode_t::off) {
+        return 0;
+    } else if (mode == reply_mode_t::skip) {
+        mode = reply_mode_t::on;
+        return 0;
+    }
+    // confirmation per channel; the count of confirmations of
+    // unsubscription of all channels is known only from the first one
+    if (!args.empty() && is_subscription_kind(args[0])) {
+        return std::max<std::size_t>(args.size() - 1, 1);
+    }
+    return 1;
+}
+
+bool is_subscription(const single_command_t &cmd) {
+    if (cmd.arguments.empty()) {
+        return false;
+    }
+    auto index = subscription_index(cmd.arguments[0]);
+    return index && *index < 3;
+}
+
+bool is_unsubscription_of_all(const single_command_t &cmd) {
+    if (cmd.arguments.size() != 1) {
+        return false;
+    }
+    auto index = subscription_index(cmd.arguments[0]);
+    return index && *index >= 3;
+}
+
+bool is_unsolicited(const markers::redis_result_t &result, bool subscribed) {
+    if (auto *push = std::get_if<markers::push_holder_t>(&result)) {
+        // RESP3 confirmations of subscriptions are pushed too
+        auto &elements = push->elements;
+        auto *kind = elements.empty()
+                         ? nullptr
+                         : std::get_if<markers::string_t>(&elements.front());
+        return !kind || !is_subscription_kind(*kind);
+    }
+    auto *array = std::get_if<markers::array_holder_t>(&result);
+    if (!subscribed || !array || array->elements.empty()) {
+        return false;
+    }
+    auto *kind = std::get_if<markers::string_t>(&array->elements.front());
+    return kind &&
+           (equal_nocase(*kind, "message") || equal_nocase(*kind, "pmessage") ||
+            equal_nocase(*kind, "smessage"));
+}
+
+std::optional<confirmation_t>
+confirmation_of(const markers::redis_result_t &reply) {
+    const std::vector<markers::redis_result_t> *elements = nullptr;
+    if (auto *array = std::get_if<markers::array_holder_t>(&reply)) {
+        elements = &array->elements;
+    } else if (auto *push = std::get_if<markers::push_holder_t>(&reply)) {
+        elements = &push->elements;
+    }
+    if (!elements || elements->size() != 3) {
+        return {};
+    }
+    auto *kind = std::get_if<markers::string_t>(&elements->front());
+    auto *count = std::get_if<markers::int_t>(&(*elements)[2]);
+    auto index = kind ? subscription_index(*kind) : std::nullopt;
+    std::size_t value = 0;
+    if (!index || !count ||
+        std::from_chars(count->data(), count->data() + count->size(), value)
+                .ec != std::errc()) {
+        return {};
+    }
+    return confirmation_t{*index % 3, *index < 3, value};
+}
+
+} // namespace details
+
+template <typename NextLayer, typename DynamicBuffer>
+void Multiplexer<NextLayer, DynamicBuffer>::async_command(
+    const single_command_t &cmd, handler_t handler) {
+    auto replies = details::replies_of(cmd, reply_mode_);
+    enqueue(cmd, std::move(handler), replies,
+            replies && details::is_unsubscription_of_all(cmd));
+}
+
+template <typename NextLayer, typename DynamicBuffer>
+void Multiplexer<NextLayer, DynamicBuffer>::async_command(
+    const single_command_t &cmd, handler_t handler,
+    std::size_t replies_count) {
+    // the reply mode is updated anyway
+    details::replies_of(cmd, reply_mode_);
+    enqueue(cmd, std::move(handler), replies_count, false);
+}
+
+template <typename NextLayer, typename DynamicBuffer>
+void Multiplexer<NextLayer, DynamicBuffer>::enqueue(
+    const single_command_t &cmd, handler_t handler, std::size_t replies_count,
+    bool unsubscribe_all) {
+    if (details::is_subscription(cmd)) {
+        subscribed_ = true;
+    }
+
+    auto confirmed = !cmd.arguments.empty() &&
+                     details::is_subscription_kind(cmd.arguments[0]);
+    pending_.push_back(pending_t{replies_count, std::move(handler), confirmed,
+                                 unsubscribe_all});
+    writer_.async_write(cmd, [this](const boost::system::error_code &ec,
+                                    std::size_t) {
+        if (ec) {
+            fail(ec);
+        }
+    });
+    read_next();
+}
+
+template <typename NextLayer, typename DynamicBuffer>
+void Multiplexer<NextLayer, DynamicBuffer>::read_next() {
+    if (reading_) {
+        return;
+    }
+    std::size_t expected = 1;
+    if (pending_.empty()) {
+        // subscription messages are awaited without commands
+        if (!subscribed_) {
+            return;
+        }
+    } else if (!pending_.front().replies) {
+        // completes via the stream executor with empty array
+        expected = 0;
+    } else if (!subscribed_) {
+        expected = pending_.front().replies;
+    }
+    // in subscribed state a message might precede the replies, so the
+    // first reply is checked on its own
+
+    reading_ = true;
+    connection_.async_read(
+        rx_buff_, storage_,
+        [this, expected](const boost::system::error_code &ec,
+                         positive_parse_result_t<parsing_policy::keep_result>
+                             &parse_result) {
+            on_read(ec, parse_result, expected);
+        },
+        expected);
+}
+
+template <typename NextLayer, typename DynamicBuffer>
+void Multiplexer<NextLayer, DynamicBuffer>::on_read(
+    const boost::system::error_code &ec,
+    positive_parse_result_t<parsing_policy::keep_result> &parse_result,
+    std::size_t expected) {
+    if (ec) {
+        reading_ = false;
+        fail(ec);
+        return;
+    }
+
+    // no reads are started until the markers are consumed, i.e. while
+    // the handlers (which might issue commands) are invoked
+    const auto &reply = parse_result.result;
+    auto unsolicited =
+        pending_.empty() || details::is_unsolicited(reply, subscribed_);
+    if (expected == 1 && !unsolicited && pending_.front().unsubscribe_all) {
+        // the confirmation per subscription of the kind follows the first
+        // one, which reports the count of subscriptions left
+        auto &front = pending_.front();
+        auto confirmation = details::confirmation_of(reply);
+        front.replies = 1 + (confirmation ? left_of(*confirmation) : 0);
+        front.unsubscribe_all = false;
+    }
+    if (expected == 1 && unsolicited) {
+        // the confirmations without commands are tracked too
+        track(reply);
+        if (push_handler_) {
+            push_handler_(reply);
+        }
+    } else if (expected == 1 && pending_.front().replies > 1) {
+        // the rest of replies follows the first one; all of them are
+        // parsed at once
+        auto replies = pending_.front().replies;
+        connection_.async_read(
+            rx_buff_, storage_,
+            [this, replies](
+                const boost::system::error_code &ec,
+                positive_parse_result_t<parsing_policy::keep_result>
+                    &parse_result) { on_read(ec, parse_result, replies); },
+            replies);
+        return;
+    } else if (!pending_.empty()) {
+        auto pending = std::move(pending_.front());
+        pending_.pop_front();
+        if (pending.confirmed) {
+            track(reply);
+        }
+        pending.handler(ec, reply);
+    }
+    // otherwise the commands have failed meanwhile, the replies are dropped
+    rx_buff_.consume(parse_result.consumed);
+    reading_ = false;
+    read_next();
+}
+
+template <typename NextLayer, typename DynamicBuffer>
+std::size_t Multiplexer<NextLayer, DynamicBuffer>::left_of(
+    const details::confirmation_t &confirmation) const {
+    if (confirmation.kind == 2) {
+        return confirmation.count;
+    }
+    // the count of channels and patterns is reported altogether
+    auto other = subscriptions_[1 - confirmation.kind];
+    return confirmation.count - std::min(confirmation.count, other);
+}
+
+template <typename NextLayer, typename DynamicBuffer>
+void Multiplexer<NextLayer, DynamicBuffer>::track(
+    const markers::redis_result_t &reply) {
+    auto *array = std::get_if<markers::array_holder_t>(&reply);
+    if (array && !array->elements.empty() &&
+        !std::holds_alternative<markers::string_t>(array->elements.front())) {
+        // the confirmations per channel
+        for (const auto &element : array->elements) {
+            track(element);
+        }
+        return;
+    }
+    auto confirmation = details::confirmation_of(reply);
+    if (!confirmation) {
+        return;
+    }
+    subscriptions_[confirmation->kind] = left_of(*confirmation);
+    if (!confirmation->subscribe &&
+        subscriptions_ == std::array<std::size_t, 3>{}) {
+        subscribed_ = false;
+    }
+}
+
+template <typename NextLayer, typename DynamicBuffer>
+void Multiplexer<NextLayer, DynamicBuffer>::fail(
+    const boost::system::error_code &ec) {
+    auto pending = std::move(pending_);
+    pending_.clear();
+    markers::redis_result_t empty{markers::array_holder_t{}};
+    for (auto &item : pending) {
+        item.handler(ec, empty);
+    }
+}
+
+} // namespace bredis
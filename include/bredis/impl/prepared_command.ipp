@@ -0,0 +1,153 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace bredis {
+
+prepared_command_t::prepared_command_t(
+    const single_command_t &pattern,
+    std::initializer_list<std::size_t> variable) {
+    const auto &arguments = pattern.arguments;
+    std::vector<bool> is_variable(arguments.size(), false);
+    for (auto position : variable) {
+        assert(position < arguments.size());
+        is_variable[position] = true;
+    }
+
+    encoded_.resize(details::header_size(arguments.size()));
+    details::write_header(encoded_.data(), '*', arguments.size());
+    for (std::size_t i = 0; i < arguments.size(); ++i) {
+        if (is_variable[i]) {
+            parts_.push_back(encoded_.size());
+            encoded_.append(terminator);
+            continue;
+        }
+        const auto &arg = arguments[i];
+        auto offset = encoded_.size();
+        encoded_.resize(offset + details::header_size(arg.size()) +
+                        arg.size() + terminator.size());
+        auto out =
+            details::write_header(&encoded_[offset], '$', arg.size());
+        out = std::copy(arg.begin(), arg.end(), out);
+        std::copy(terminator.begin(), terminator.end(), out);
+    }
+    parts_.push_back(encoded_.size());
+
+    auto max_header =
+        details::header_size(std::numeric_limits<std::size_t>::max());
+    headers_.resize(arity() * max_header);
+    header_sizes_.reserve(arity());
+    values_.reserve(arity());
+    buffers_.reserve(arity() * 3 + 1);
+    if (!arity()) {
+        size_ = encoded_.size();
+    }
+    update_buffers();
+}
+
+prepared_command_t::prepared_command_t(const prepared_command_t &other)
+    : encoded_(other.encoded_), parts_(other.parts_),
+      headers_(other.headers_), header_sizes_(other.header_sizes_),
+      values_(other.values_), size_(other.size_) {
+    buffers_.reserve(arity() * 3 + 1);
+    update_buffers();
+}
+
+prepared_command_t::prepared_command_t(prepared_command_t &&other)
+    : encoded_(std::move(other.encoded_)), parts_(std::move(other.parts_)),
+      headers_(std::move(other.headers_)),
+      header_sizes_(std::move(other.header_sizes_)),
+      values_(std::move(other.values_)), buffers_(std::move(other.buffers_)),
+      size_(other.size_) {
+    // the short encoding is moved along with the string object
+    update_buffers();
+}
+
+prepared_command_t &
+prepared_command_t::operator=(const prepared_command_t &other) {
+    if (this != &other) {
+        encoded_ = other.encoded_;
+        parts_ = other.parts_;
+        headers_ = other.headers_;
+        header_sizes_ = other.header_sizes_;
+        values_ = other.values_;
+        size_ = other.size_;
+        update_buffers();
+    }
+    return *this;
+}
+
+prepared_command_t &prepared_command_t::operator=(prepared_command_t &&other) {
+    if (this != &other) {
+        encoded_ = std::move(other.encoded_);
+        parts_ = std::move(other.parts_);
+        headers_ = std::move(other.headers_);
+        header_sizes_ = std::move(other.header_sizes_);
+        values_ = std::move(other.values_);
+        buffers_ = std::move(other.buffers_);
+        size_ = other.size_;
+        update_buffers();
+    }
+    return *this;
+}
+
+void prepared_command_t::bind_values(const std::string_view *values,
+                                     std::size_t count) {
+    // the header slots are reserved for arity() values exactly
+    if (count != arity()) {
+        throw std::invalid_argument("prepared command: " +
+                                    std::to_string(arity()) +
+                                    " values expected, but " +
+                                    std::to_string(count) + " are bound");
+    }
+    auto max_header =
+        details::header_size(std::numeric_limits<std::size_t>::max());
+    header_sizes_.clear();
+    values_.assign(values, values + count);
+    size_ = encoded_.size();
+    for (std::size_t i = 0; i < count; ++i) {
+        auto header = &headers_[i * max_header];
+        auto header_size =
+            details::write_header(header, '$', values[i].size()) - header;
+        header_sizes_.push_back(header_size);
+        size_ += header_size + values[i].size();
+    }
+    update_buffers();
+}
+
+void prepared_command_t::update_buffers() {
+    buffers_.clear();
+    if (!arity()) {
+        buffers_.emplace_back(encoded_.data(), encoded_.size());
+        return;
+    } else if (values_.empty()) {
+        // not bound yet
+        return;
+    }
+    auto max_header =
+        details::header_size(std::numeric_limits<std::size_t>::max());
+    std::size_t part_start = 0;
+    for (std::size_t i = 0; i < values_.size(); ++i) {
+        buffers_.emplace_back(encoded_.data() + part_start,
+                              parts_[i] - part_start);
+        buffers_.emplace_back(headers_.data() + i * max_header,
+                              header_sizes_[i]);
+        buffers_.emplace_back(values_[i].data(), values_[i].size());
+        part_start = parts_[i];
+    }
+    buffers_.emplace_back(encoded_.data() + part_start,
+                          encoded_.size() - part_start);
+}
+
+} // namespace bredis
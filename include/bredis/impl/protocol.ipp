@@ -7,11 +7,15 @@
 #pragma once
 
 #include <algorithm>
-#include <boost/lexical_cast.hpp>
-#include <variant>
-#include <errno.h>
-#include <stdlib.h>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <string>
+#include <variant>
+
+#include "terminator.ipp"
 
 namespace bredis {
 
@@ -21,354 +25,781 @@ constexpr std::string_view terminator{"\r\n"};
 
 namespace details {
 
-// forward declaration
-template <typename Policy>
-parse_result_t<Policy> raw_parse(std::string_view view);
-
-struct count_value_t {
-    size_t value;
-    size_t consumed;
-};
-
-template <typename Policy>
-using count_variant_t =
-    std::variant<count_value_t, parse_result_t<Policy>>;
+// count (of bulk string bytes or array elements) or -1 for nil
+using count_result_t = std::variant<long, protocol_error_t>;
 
-template <typename Policy> struct markup_helper_t {
-    using result_wrapper_t = parse_result_t<Policy>;
-    using positive_wrapper_t = parse_result_mapper_t<Policy>;
-    using result_t = markers::redis_result_t;
-    using string_t = markers::string_t;
+// decodes count right from the header, without copying it and without
+// locale-dependent conversion
+inline count_result_t parse_count(std::string_view view) {
+    // 19 digits always fit into 64 bits
+    constexpr std::size_t max_digits = 19;
 
-    static auto markup_string(size_t consumed, std::string_view view) -> result_wrapper_t {
-        return positive_wrapper_t{
-            result_t{markers::string_t{view}}, consumed};
+    std::size_t size = view.size();
+    bool negative = size && view[0] == '-';
+    std::size_t i = negative ? 1 : 0;
+    if (i == size || size - i > max_digits) {
+        return protocol_error_t{
+            Error::make_error_code(bredis_errors::count_conversion)};
     }
 
-    static auto markup_nil(size_t consumed, const string_t &str)
-        -> result_wrapper_t {
-        return positive_wrapper_t{
-            result_t{markers::nil_t{str}}, consumed};
+    std::uint64_t value = 0;
+    for (; i < size; ++i) {
+        unsigned digit = static_cast<unsigned char>(view[i]) - '0';
+        if (digit > 9) {
+            return protocol_error_t{
+                Error::make_error_code(bredis_errors::count_conversion)};
+        }
+        value = value * 10 + digit;
     }
 
-    static auto markup_error(positive_wrapper_t &wrapped_string)
-        -> result_wrapper_t {
-        auto &str = std::get<string_t>(wrapped_string.result);
-        return positive_wrapper_t{result_t{markers::error_t{str}},
-                               wrapped_string.consumed};
+    if (value > static_cast<std::uint64_t>(std::numeric_limits<long>::max())) {
+        return protocol_error_t{
+            Error::make_error_code(bredis_errors::count_conversion)};
+    } else if (negative && value > 1) {
+        return protocol_error_t{
+            Error::make_error_code(bredis_errors::count_range)};
     }
+    return negative ? -static_cast<long>(value) : static_cast<long>(value);
+}
 
-    static auto markup_int(positive_wrapper_t &wrapped_string)
-        -> result_wrapper_t {
-        auto &str = std::get<string_t>(wrapped_string.result);
-        return positive_wrapper_t{
-            result_t{markers::int_t{str}}, wrapped_string.consumed};
-    }
+template <markers::tape_kind_t kind> struct marker_of;
+template <> struct marker_of<markers::tape_kind_t::string> {
+    using type = markers::string_t;
+};
+template <> struct marker_of<markers::tape_kind_t::error> {
+    using type = markers::error_t;
+};
+template <> struct marker_of<markers::tape_kind_t::int_> {
+    using type = markers::int_t;
+};
+template <> struct marker_of<markers::tape_kind_t::nil> {
+    using type = markers::nil_t;
+};
+template <> struct marker_of<markers::tape_kind_t::array> {
+    using type = markers::array_holder_t;
+};
+template <> struct marker_of<markers::tape_kind_t::double_> {
+    using type = markers::double_t;
+};
+template <> struct marker_of<markers::tape_kind_t::bool_> {
+    using type = markers::bool_t;
+};
+template <> struct marker_of<markers::tape_kind_t::big_number> {
+    using type = markers::big_number_t;
+};
+template <> struct marker_of<markers::tape_kind_t::verbatim> {
+    using type = markers::verbatim_t;
+};
+template <> struct marker_of<markers::tape_kind_t::map> {
+    using type = markers::map_holder_t;
+};
+template <> struct marker_of<markers::tape_kind_t::set> {
+    using type = markers::set_holder_t;
+};
+template <> struct marker_of<markers::tape_kind_t::push> {
+    using type = markers::push_holder_t;
 };
 
-template <>
-struct markup_helper_t<parsing_policy::drop_result> {
-    using policy_t = parsing_policy::drop_result;
-    using result_wrapper_t = parse_result_t<policy_t>;
-    using positive_wrapper_t = parse_result_mapper_t<policy_t>;
-    using string_t = markers::string_t;
+template <markers::tape_kind_t kind>
+using marker_of_t = typename marker_of<kind>::type;
 
-    static auto markup_string(size_t consumed, std::string_view view) -> result_wrapper_t {
-        return positive_wrapper_t{consumed};
-    }
+template <markers::tape_kind_t kind>
+void emplace_marker(markers::redis_result_t &into, std::string_view str) {
+    into.emplace<marker_of_t<kind>>(marker_of_t<kind>{str});
+}
 
-    static auto markup_nil(size_t consumed, const string_t &str)
-        -> result_wrapper_t {
-        return positive_wrapper_t{consumed};
-    }
+// the aggregate count comes from network, so it is trusted only up to
+// the limit when reserving the elements
+constexpr std::size_t max_reserve = 1 << 20;
+
+// The tape entry of markup_recorder_t; unlike tape_t, whose entries are
+// compact, the offsets are not limited.
+struct markup_entry_t {
+    std::size_t offset;
+    std::size_t length;
+    std::size_t children;
+    markers::tape_kind_t kind;
+};
 
-    static auto markup_error(positive_wrapper_t &wrapped_string)
-        -> result_wrapper_t {
-        return positive_wrapper_t{wrapped_string.consumed};
+// Records the parsed elements into the flat tape with offsets relative
+// to the buffer start, as the buffer might be relocated while the next
+// chunks are arriving. The offset range is limited by the entry type.
+template <typename Entry> struct basic_tape_recorder_t {
+    using kind_t = markers::tape_kind_t;
+    using field_t = decltype(Entry::offset);
+
+    static constexpr std::size_t max_offset =
+        std::numeric_limits<field_t>::max();
+
+    std::vector<Entry> entries_;
+    // tape indices of the arrays being filled
+    inline_stack_t<std::size_t, BREDIS_MAX_NESTING_DEPTH> arrays_;
+    // entries of the completely parsed replies, i.e. the entries of
+    // partially parsed reply follow them
+    std::size_t replies_end_ = 0;
+
+    void clear(std::size_t expected_count, bool /* wrap */) {
+        entries_.clear();
+        entries_.reserve(expected_count);
+        arrays_.clear();
+        replies_end_ = 0;
     }
 
-    static auto markup_int(positive_wrapper_t &wrapped_string)
-        -> result_wrapper_t {
-        return positive_wrapper_t{wrapped_string.consumed};
+    // only the entries of the partially parsed reply are left
+    void rebase(std::size_t consumed, std::size_t /* expected_count */,
+                bool /* wrap */) {
+        entries_.erase(entries_.begin(), entries_.begin() + replies_end_);
+        for (auto &entry : entries_) {
+            entry.offset -= static_cast<field_t>(consumed);
+        }
+        for (auto &index : arrays_) {
+            index -= replies_end_;
+        }
+        replies_end_ = 0;
     }
-};
 
-template <typename Policy> struct array_helper_t {
-    using policy_t = Policy;
-    using array_t = markers::array_holder_t;
-    using item_t = parse_result_mapper_t<policy_t>;
-    using result_t = parse_result_t<policy_t>;
-
-    size_t consumed_;
-    size_t count_;
-    array_t array_;
-
-    array_helper_t(size_t consumed, size_t count)
-        : consumed_{consumed}, count_{count} {
-        array_.elements.reserve(count);
+    template <kind_t kind>
+    void record(const char * /* ptr */, std::size_t offset,
+                std::size_t size) {
+        auto &entries = entries_;
+        if constexpr (markers::is_aggregate(kind)) {
+            if (size) {
+                // parser guarantees that the nesting depth is not exceeded
+                arrays_.push_back(entries.size());
+                auto required =
+                    entries.size() + 1 + std::min(size, max_reserve);
+                if (required > entries.capacity()) {
+                    entries.reserve(
+                        std::max(required, entries.capacity() * 2));
+                }
+            }
+            // parser guarantees that offset and count fit into the entry
+            entries.push_back(Entry{static_cast<field_t>(offset), 1,
+                                    static_cast<field_t>(size), kind});
+        } else {
+            entries.push_back(Entry{static_cast<field_t>(offset),
+                                    static_cast<field_t>(size), 0, kind});
+        }
     }
 
-    void push(const item_t &item) {
-        consumed_ += item.consumed;
-        array_.elements.emplace_back(item.result);
+    void array_parsed() {
+        auto index = arrays_.back();
+        arrays_.pop_back();
+        entries_[index].length =
+            static_cast<field_t>(entries_.size() - index);
     }
 
-    result_t get() { return item_t{std::move(array_), consumed_}; }
+    void reply_parsed() { replies_end_ = entries_.size(); }
 };
 
-template <>
-struct array_helper_t<parsing_policy::drop_result> {
-    using policy_t = parsing_policy::drop_result;
-    using array_t = markers::array_holder_t;
-    using item_t = parse_result_mapper_t<policy_t>;
-    using result_t = parse_result_t<policy_t>;
-
-    size_t consumed_;
-
-    array_helper_t(size_t consumed, size_t count) : consumed_{consumed} {}
+// the entries of tape_t are 32-bit, i.e. the replies of a single read may
+// not exceed 4GB
+using tape_recorder_t = basic_tape_recorder_t<markers::tape_entry_t>;
 
-    void push(const item_t &item) { consumed_ += item.consumed; }
+// Builds markers from the tape of the parsed replies.
+template <typename Policy>
+struct markup_recorder_t : basic_tape_recorder_t<markup_entry_t> {
+    using base_t = basic_tape_recorder_t<markup_entry_t>;
 
-    result_t get() { return result_t{item_t{consumed_}}; }
-};
+    // the replies are wrapped into array, unless a single one is expected
+    bool wrap_ = false;
 
-template <typename Policy>
-struct unwrap_count_t {
-    using wrapped_result_t = count_variant_t<Policy>;
-    using negative_result_t = parse_result_t<Policy>;
-    using positive_input_t =
-        parse_result_mapper_t<parsing_policy::keep_result>;
+    void clear(std::size_t expected_count, bool wrap) {
+        base_t::clear(expected_count, wrap);
+        wrap_ = wrap;
+    }
 
-    template <typename T> wrapped_result_t operator()(const T &value) const {
-        return negative_result_t{value};
+    void rebase(std::size_t consumed, std::size_t expected_count, bool wrap) {
+        base_t::rebase(consumed, expected_count, wrap);
+        wrap_ = wrap;
     }
 
-    wrapped_result_t operator()(const positive_input_t &value) const {
-        using string_t = markers::string_t;
-        using helper = markup_helper_t<Policy>;
+    // constructs markers right in the place, to avoid copying of them;
+    // already allocated aggregates are reused
+    void build(const char *buffer, std::size_t &index,
+               markers::redis_result_t &into) const {
+        auto &entry = entries_[index++];
+        std::string_view str{buffer + entry.offset, entry.length};
+        std::vector<markers::redis_result_t> *elements = nullptr;
+        switch (entry.kind) {
+        case kind_t::string:
+            emplace_marker<kind_t::string>(into, str);
+            return;
+        case kind_t::error:
+            emplace_marker<kind_t::error>(into, str);
+            return;
+        case kind_t::int_:
+            emplace_marker<kind_t::int_>(into, str);
+            return;
+        case kind_t::nil:
+            emplace_marker<kind_t::nil>(into, str);
+            return;
+        case kind_t::double_:
+            emplace_marker<kind_t::double_>(into, str);
+            return;
+        case kind_t::bool_:
+            emplace_marker<kind_t::bool_>(into, str);
+            return;
+        case kind_t::big_number:
+            emplace_marker<kind_t::big_number>(into, str);
+            return;
+        case kind_t::verbatim:
+            emplace_marker<kind_t::verbatim>(into, str);
+            return;
+        case kind_t::array:
+            elements = &reuse_holder<kind_t::array>(into, entry.children);
+            break;
+        case kind_t::map:
+            elements = &reuse_holder<kind_t::map>(into, entry.children);
+            break;
+        case kind_t::set:
+            elements = &reuse_holder<kind_t::set>(into, entry.children);
+            break;
+        case kind_t::push:
+            elements = &reuse_holder<kind_t::push>(into, entry.children);
+            break;
+        }
+        for (auto &element : *elements) {
+            build(buffer, index, element);
+        }
+    }
 
-        auto &count_string_ref = std::get<string_t>(value.result);
-        std::string count_string{count_string_ref};
-        auto count_consumed = value.consumed;
-        const char *count_ptr = count_string.c_str();
-        char *count_end;
+    template <kind_t kind>
+    static std::vector<markers::redis_result_t> &
+    reuse_holder(markers::redis_result_t &into, std::size_t size) {
+        using holder_t = marker_of_t<kind>;
+        auto *holder = std::get_if<holder_t>(&into);
+        if (!holder) {
+            holder = &into.emplace<holder_t>();
+        }
+        holder->elements.resize(size);
+        return holder->elements;
+    }
 
-        errno = 0;
-        long count = strtol(count_ptr, &count_end, 10);
-        if (errno) {
-            return protocol_error_t{
-                Error::make_error_code(bredis_errors::count_conversion)};
-        } else if (count == -1) {
-            return helper::markup_nil(count_consumed, count_string_ref);
-        } else if (count < -1) {
-            return protocol_error_t{
-                Error::make_error_code(bredis_errors::count_range)};
+    void result(const char *buffer, std::size_t replies_count,
+                std::size_t consumed, parse_result_mapper_t<Policy> &into) {
+        std::size_t index = 0;
+        into.consumed = consumed;
+        if (!wrap_) {
+            build(buffer, index, into.result);
+        } else {
+            for (auto &reply :
+                 reuse_holder<kind_t::array>(into.result, replies_count)) {
+                build(buffer, index, reply);
+            }
         }
+    }
 
-        return count_value_t{static_cast<size_t>(count), count_consumed};
+    parse_result_mapper_t<Policy> result(const char *buffer,
+                                         std::size_t replies_count,
+                                         std::size_t consumed) {
+        parse_result_mapper_t<Policy> into{{}, consumed};
+        result(buffer, replies_count, consumed, into);
+        return into;
     }
 };
 
-template <typename Policy> struct string_parser_t {
+template <>
+struct markup_recorder_t<parsing_policy::tape_result> : tape_recorder_t {
+    using policy_t = parsing_policy::tape_result;
+
+    parse_result_mapper_t<policy_t> result(const char *buffer,
+                                           std::size_t replies_count,
+                                           std::size_t consumed) {
+        parse_result_mapper_t<policy_t> into{};
+        result(buffer, replies_count, consumed, into);
+        return into;
+    }
 
-    static auto apply(std::string_view view, size_t already_consumed)
-        -> parse_result_t<Policy> {
-        using helper = markup_helper_t<Policy>;
+    // the entries of the previous result are taken for the next parsing;
+    // the entries of the partially parsed reply are moved there, i.e. the
+    // tape is rebased onto them right away
+    void result(const char *buffer, std::size_t /* replies_count */,
+                std::size_t consumed, parse_result_mapper_t<policy_t> &into) {
+        auto &entries = into.result.entries;
+        entries.assign(entries_.begin() + replies_end_, entries_.end());
+        entries_.resize(replies_end_);
+        std::swap(entries_, entries);
+        for (auto &index : arrays_) {
+            index -= replies_end_;
+        }
+        replies_end_ = 0;
+        into.result.buffer = buffer;
+        into.consumed = consumed;
+    }
+};
 
-		auto found_terminator = view.find(terminator);
+template <> struct markup_recorder_t<parsing_policy::drop_result> {
+    using policy_t = parsing_policy::drop_result;
+    using kind_t = markers::tape_kind_t;
+
+    static constexpr std::size_t max_offset =
+        std::numeric_limits<std::size_t>::max();
+
+    std::size_t depth_ = 0;
+    std::size_t replies_ = 0;
+    std::size_t errors_ = 0;
+    std::size_t first_error_index_ = 0;
+    // the error payload might be not received yet, when it is recorded
+    std::size_t first_error_offset_ = 0;
+    std::size_t first_error_length_ = 0;
+    // the error is recorded, but its reply is not parsed yet
+    bool error_pending_ = false;
+    std::size_t pending_offset_ = 0;
+    std::size_t pending_length_ = 0;
+
+    void clear(std::size_t /* expected_count */, bool /* wrap */) {
+        depth_ = replies_ = errors_ = 0;
+        error_pending_ = false;
+    }
 
-        if (found_terminator == std::string_view::npos) {
-            return not_enough_data_t{};
+    // the error of the partially parsed reply is the first one
+    void rebase(std::size_t consumed, std::size_t /* expected_count */,
+                bool /* wrap */) {
+        replies_ = 0;
+        errors_ = error_pending_ ? 1 : 0;
+        if (error_pending_) {
+            first_error_index_ = 0;
+            first_error_offset_ = pending_offset_ - consumed;
+            first_error_length_ = pending_length_;
         }
+    }
 
-        size_t consumed = already_consumed + terminator.size() + found_terminator;
-        return helper::markup_string(consumed, view.substr(0, found_terminator));
+    template <kind_t kind>
+    void record(const char * /* ptr */, std::size_t offset, std::size_t size) {
+        if constexpr (markers::is_aggregate(kind)) {
+            if (size) {
+                ++depth_;
+            }
+        } else if constexpr (kind == kind_t::error) {
+            if (!depth_) {
+                if (!errors_++) {
+                    first_error_index_ = replies_;
+                    first_error_offset_ = offset;
+                    first_error_length_ = size;
+                }
+                error_pending_ = true;
+                pending_offset_ = offset;
+                pending_length_ = size;
+            }
+        }
     }
-};
 
-template <typename Policy> struct error_parser_t {
-    static auto apply(std::string_view view, size_t already_consumed)
-        -> parse_result_t<Policy> {
-        using helper = markup_helper_t<Policy>;
-        using parser_t = string_parser_t<Policy>;
-        using wrapped_result_t = parse_result_mapper_t<Policy>;
+    void array_parsed() { --depth_; }
 
-        auto result = parser_t::apply(view, already_consumed);
-        if (auto *wrapped_string = std::get_if<wrapped_result_t>(&result); !wrapped_string) {
-            return result;
-        } else {
-	        return helper::markup_error(*wrapped_string);
-	    }
+    void reply_parsed() {
+        ++replies_;
+        error_pending_ = false;
     }
-};
 
-template <typename Policy> struct int_parser_t {
-    static auto apply(std::string_view view, size_t already_consumed)
-        -> parse_result_t<Policy> {
-        using helper = markup_helper_t<Policy>;
-        using parser_t = string_parser_t<Policy>;
-        using wrapped_result_t = parse_result_mapper_t<Policy>;
+    parse_result_mapper_t<policy_t> result(const char *buffer,
+                                           std::size_t replies_count,
+                                           std::size_t consumed) {
+        parse_result_mapper_t<policy_t> into{consumed, 0, 0, 0, {}};
+        result(buffer, replies_count, consumed, into);
+        return into;
+    }
 
-        auto result = parser_t::apply(view, already_consumed);
-        if (auto *wrapped_string = std::get_if<wrapped_result_t>(&result); !wrapped_string) {
-            return result;
-        } else {
-            return helper::markup_int(*wrapped_string);
-	    }
+    void result(const char *buffer, std::size_t /* replies_count */,
+                std::size_t consumed, parse_result_mapper_t<policy_t> &into) {
+        into.consumed = consumed;
+        into.replies = replies_;
+        into.errors = errors_;
+        into.first_error_index = first_error_index_;
+        into.first_error.clear();
+        if (errors_ && buffer) {
+            into.first_error.assign(buffer + first_error_offset_,
+                                    first_error_length_);
+        }
     }
 };
 
-template <typename Policy> struct bulk_string_parser_t {
-
-    static auto apply(std::string_view view, size_t already_consumed)
-        -> parse_result_t<Policy> {
+// Builds markers right during parsing, i.e. without intermediate markup;
+// suitable only when the buffer is not relocated between advances. Only
+// the innermost array being filled grows, so the pointers to the outer
+// ones remain valid, even when the elements are reallocated.
+template <typename Policy> struct direct_recorder_t {
+    using kind_t = markers::tape_kind_t;
+
+    static constexpr std::size_t max_offset =
+        std::numeric_limits<std::size_t>::max();
+    using elements_t = std::vector<markers::redis_result_t>;
+
+    markers::redis_result_t result_;
+    elements_t *replies_;
+    inline_stack_t<elements_t *, BREDIS_MAX_NESTING_DEPTH> arrays_;
+
+    void clear(std::size_t expected_count, bool wrap) {
+        arrays_.clear();
+        replies_ = nullptr;
+        if (wrap) {
+            auto &replies = result_.emplace<markers::array_holder_t>();
+            replies.elements.reserve(expected_count);
+            replies_ = &replies.elements;
+        }
+    }
 
-        using helper = markup_helper_t<Policy>;
-        using count_unwrapper_t = unwrap_count_t<Policy>;
-        using keep_policy = parsing_policy::keep_result;
-        using count_parser_t = string_parser_t<keep_policy>;
-        using result_t = parse_result_t<Policy>;
+    markers::redis_result_t &next_slot() {
+        auto elements = arrays_.empty() ? replies_ : arrays_.back();
+        if (!elements) {
+            return result_;
+        }
+        return elements->emplace_back();
+    }
 
-        auto count_result = count_parser_t::apply(view, already_consumed);
-        auto count_int_result =
-            std::visit(count_unwrapper_t{}, count_result);
-        if (auto *count_wrapped = std::get_if<count_value_t>(&count_int_result); !count_wrapped) {
-            return std::get<result_t>(count_int_result);
-        } else {
-            auto head = count_wrapped->consumed - already_consumed;
-            size_t left = view.size() - head;
-            size_t count = count_wrapped->value;
-            auto terminator_size = terminator.size();
-            if (left < count + terminator_size) {
-                return not_enough_data_t{};
+    template <kind_t kind>
+    void record(const char *ptr, std::size_t /* offset */, std::size_t size) {
+        markers::redis_result_t &into = next_slot();
+        if constexpr (markers::is_aggregate(kind)) {
+            auto &holder = into.emplace<marker_of_t<kind>>();
+            if (size) {
+                // parser guarantees that the nesting depth is not exceeded
+                holder.elements.reserve(std::min(size, max_reserve));
+                arrays_.push_back(&holder.elements);
             }
-            auto tail = view.substr(head + count, terminator.size());
+        } else {
+            emplace_marker<kind>(into, std::string_view{ptr, size});
+        }
+    }
 
-			bool found_terminator = terminator == tail;
-            if (!found_terminator) {
-                return protocol_error_t{
-                    Error::make_error_code(bredis_errors::bulk_terminator)};
-            }
-            size_t consumed = count_wrapped->consumed + count + terminator_size;
+    void array_parsed() { arrays_.pop_back(); }
 
-			view = view.substr(head, count);
-            return helper::markup_string(consumed, view);
-		}
-    }
-};
+    void reply_parsed() {}
 
-template <typename Policy> struct array_parser_t {
-    static auto apply(std::string_view view, size_t already_consumed)
-        -> parse_result_t<Policy> {
-
-        using helper = markup_helper_t<Policy>;
-        using count_unwrapper_t = unwrap_count_t<Policy>;
-        using result_t = parse_result_t<Policy>;
-        using keep_policy = parsing_policy::keep_result;
-        using count_parser_t = string_parser_t<keep_policy>;
-        using array_helper = array_helper_t<Policy>;
-        using element_t = parse_result_mapper_t<Policy>;
-
-        auto count_result = count_parser_t::apply(view, already_consumed);
-        auto count_int_result =
-            std::visit(count_unwrapper_t{}, count_result);
-        if (auto *count_wrapped = std::get_if<count_value_t>(&count_int_result); !count_wrapped) {
-            return std::get<result_t>(count_int_result);
-		}
-		else {
-			auto count = count_wrapped->value;
-			array_helper elements{ count_wrapped->consumed, count };
-			long marked_elements{ 0 };
-			auto element_from = count_wrapped->consumed - already_consumed;
-			while (marked_elements < count) {
-				auto element_result = raw_parse<Policy>(view.substr(element_from));
-				if (auto *element = std::get_if<element_t>(&element_result); !element) {
-					return element_result;
-				}
-				else {
-					element_from += element->consumed;
-					elements.push(*element);
-					++marked_elements;
-				}
-			}
-			return elements.get();
-		}
+    parse_result_mapper_t<Policy> result(const char * /* buffer */,
+                                         std::size_t /* replies_count */,
+                                         std::size_t consumed) {
+        return {std::move(result_), consumed};
     }
 };
 
-template <typename Policy>
-using primary_parser_t = std::variant<
-    not_enough_data_t, protocol_error_t, string_parser_t<Policy>,
-    int_parser_t<Policy>, error_parser_t<Policy>,
-    bulk_string_parser_t<Policy>, array_parser_t<Policy>>;
+template <>
+struct direct_recorder_t<parsing_policy::drop_result>
+    : markup_recorder_t<parsing_policy::drop_result> {};
 
-template <typename Policy>
-struct unwrap_primary_parser_t {
-    using wrapped_result_t = parse_result_t<Policy>;
+template <>
+struct direct_recorder_t<parsing_policy::tape_result>
+    : markup_recorder_t<parsing_policy::tape_result> {};
 
-	std::string_view from_;
-    unwrap_primary_parser_t(std::string_view from)
-        : from_{from} {}
+} // namespace details
 
-    wrapped_result_t operator()(const not_enough_data_t &value) const {
-        return value;
+template <typename Policy>
+parse_result_t<Policy> Protocol::parse(std::string_view view) {
+    ResumableParser<Policy, details::direct_recorder_t<Policy>> parser;
+    parser.advance(view);
+    if (parser.error()) {
+        return parser.error();
+    } else if (!parser.complete()) {
+        return not_enough_data_t{};
     }
+    return parser.result(view.data());
+}
 
-    wrapped_result_t operator()(const protocol_error_t &value) const {
-        return value;
-    }
+template <typename Policy, typename Recorder>
+void ResumableParser<Policy, Recorder>::reset(std::size_t expected_count,
+                                              std::size_t start) {
+    reset(expected_count, start, expected_count != 1);
+}
+
+template <typename Policy, typename Recorder>
+void ResumableParser<Policy, Recorder>::reset(std::size_t expected_count,
+                                              std::size_t start, bool wrap) {
+    expected_count_ = expected_count;
+    replies_count_ = 0;
+    start_ = start;
+    position_ = start;
+    consumed_ = start;
+    scanned_ = 0;
+    bulk_left_ = 0;
+    in_bulk_ = false;
+    frames_.clear();
+    attribute_level_ = 0;
+    error_ = protocol_error_t{};
+    recorder_.clear(expected_count, wrap);
+}
+
+template <typename Policy, typename Recorder>
+void ResumableParser<Policy, Recorder>::rebase(std::size_t expected_count,
+                                               bool wrap) {
+    auto consumed = consumed_;
+    recorder_.rebase(consumed, expected_count, wrap);
+    expected_count_ = expected_count;
+    replies_count_ = 0;
+    start_ = 0;
+    position_ -= consumed;
+    consumed_ = 0;
+}
 
-    template <typename Parser>
-    wrapped_result_t operator()(const Parser &ignored) const {
-        return Parser::apply(from_.substr(1), 1);
+template <typename Policy, typename Recorder>
+void ResumableParser<Policy, Recorder>::element_parsed(std::size_t position) {
+    while (!frames_.empty()) {
+        auto &frame = frames_.back();
+        if (--frame.left) {
+            return;
+        }
+        auto attribute = frame.attribute;
+        frames_.pop_back();
+        if (attribute) {
+            if (attribute_level_ == frames_.size() + 1) {
+                attribute_level_ = 0;
+            }
+            // the described element is still to be parsed
+            return;
+        }
+        if (!attribute_level_) {
+            recorder_.array_parsed();
+        }
     }
-};
+    ++replies_count_;
+    consumed_ = position;
+    recorder_.reply_parsed();
+}
 
-template <typename Policy>
-struct construct_primary_parcer_t {
-    using result_t = primary_parser_t<Policy>;
+template <typename Policy, typename Recorder>
+std::size_t ResumableParser<Policy, Recorder>::advance(std::string_view view) {
+    using kind_t = markers::tape_kind_t;
+
+    std::size_t at = 0;
+    while (!complete()) {
+        if (in_bulk_) {
+            // payload bytes are just skipped, the terminator is checked
+            // only when it is completely available
+            size_t left = view.size() - at;
+            if (left < bulk_left_ + terminator.size()) {
+                auto skipped = std::min(left, bulk_left_);
+                bulk_left_ -= skipped;
+                at += skipped;
+                break;
+            }
+            if (view.substr(at + bulk_left_, terminator.size()) !=
+                terminator) {
+                error_ = Error::make_error_code(bredis_errors::bulk_terminator);
+                break;
+            }
+            at += bulk_left_ + terminator.size();
+            in_bulk_ = false;
+            bulk_left_ = 0;
+            element_parsed(position_ + at);
+            continue;
+        }
 
-    static auto apply(std::string_view view) -> result_t {
-        if (view.empty()) {
-            return not_enough_data_t{};
+        auto line = view.substr(at);
+        if (line.empty()) {
+            break;
+        }
+        auto introduction = line[0];
+        switch (introduction) {
+        case '+':
+        case '-':
+        case ':':
+        case '$':
+        case '*':
+        // RESP3
+        case ',':
+        case '#':
+        case '(':
+        case '_':
+        case '=':
+        case '!':
+        case '%':
+        case '~':
+        case '>':
+        case '|':
+            break;
+        default:
+            error_ = Error::make_error_code(bredis_errors::wrong_intoduction);
+        }
+        if (error_) {
+            break;
         }
 
-        switch (view[0]) {
-        case '+': {
-            return string_parser_t<Policy>{};
+        // the already scanned part of incomplete line is not scanned again;
+        // the last scanned byte might be the first half of the terminator
+        auto found_terminator = details::find_terminator(
+            line, std::max<std::size_t>(scanned_, 1));
+        if (found_terminator == std::string_view::npos) {
+            scanned_ = line.size() - 1;
+            break;
         }
-        case '-': {
-            return error_parser_t<Policy>{};
+        scanned_ = 0;
+        auto content_offset = position_ + at + 1;
+        auto content = line.substr(1, found_terminator - 1);
+        auto next = at + found_terminator + terminator.size();
+        if (position_ + next > Recorder::max_offset) {
+            error_ = Error::make_error_code(bredis_errors::offset_range);
+            break;
         }
-        case ':': {
-            return int_parser_t<Policy>{};
+
+        auto ptr = content.data();
+        auto size = content.size();
+        bool simple = true;
+        switch (introduction) {
+        case '+':
+            record<kind_t::string>(ptr, content_offset, size);
+            break;
+        case '-':
+            record<kind_t::error>(ptr, content_offset, size);
+            break;
+        case ':':
+            record<kind_t::int_>(ptr, content_offset, size);
+            break;
+        case ',':
+            record<kind_t::double_>(ptr, content_offset, size);
+            break;
+        case '#':
+            record<kind_t::bool_>(ptr, content_offset, size);
+            break;
+        case '(':
+            record<kind_t::big_number>(ptr, content_offset, size);
+            break;
+        case '_':
+            record<kind_t::nil>(ptr, content_offset, size);
+            break;
+        default:
+            simple = false;
         }
-        case '$': {
-            return bulk_string_parser_t<Policy>{};
+        if (simple) {
+            at = next;
+            element_parsed(position_ + at);
+            continue;
         }
-        case '*': {
-            return array_parser_t<Policy>{};
+
+        auto count_result = details::parse_count(content);
+        if (auto *count_error = std::get_if<protocol_error_t>(&count_result);
+            count_error) {
+            error_ = *count_error;
+            break;
         }
+        long count = std::get<long>(count_result);
+        if (count == -1) {
+            // RESP2 null bulk string and null array
+            if (introduction != '$' && introduction != '*') {
+                error_ = Error::make_error_code(bredis_errors::count_range);
+                break;
+            }
+            at = next;
+            record<kind_t::nil>(ptr, content_offset, size);
+            element_parsed(position_ + at);
+            continue;
+        }
+        at = next;
+        auto length = static_cast<std::size_t>(count);
+
+        if (introduction == '$' || introduction == '=' || introduction == '!') {
+            if (length > Recorder::max_offset - (position_ + at)) {
+                error_ = Error::make_error_code(bredis_errors::offset_range);
+                break;
+            }
+            auto payload = view.data() + at;
+            if (introduction == '$') {
+                record<kind_t::string>(payload, position_ + at, length);
+            } else if (introduction == '=') {
+                record<kind_t::verbatim>(payload, position_ + at, length);
+            } else {
+                record<kind_t::error>(payload, position_ + at, length);
+            }
+            in_bulk_ = true;
+            bulk_left_ = length;
+            continue;
+        }
+
+        // aggregates: the map and the attribute consist of key/value pairs
+        constexpr auto max_count = std::numeric_limits<std::uint32_t>::max();
+        bool pairs = introduction == '%' || introduction == '|';
+        if (length > (pairs ? max_count / 2 : max_count)) {
+            error_ = Error::make_error_code(bredis_errors::count_range);
+            break;
+        }
+        auto elements = pairs ? length * 2 : length;
+        if (elements && frames_.full()) {
+            error_ = Error::make_error_code(bredis_errors::nesting_depth);
+            break;
+        }
+        if (introduction == '|') {
+            if (elements) {
+                frames_.push_back(details::frame_t{elements, true});
+                if (!attribute_level_) {
+                    attribute_level_ = frames_.size();
+                }
+            }
+            continue;
+        }
+        if (introduction == '*') {
+            record<kind_t::array>(ptr, content_offset, elements);
+        } else if (introduction == '%') {
+            record<kind_t::map>(ptr, content_offset, elements);
+        } else if (introduction == '~') {
+            record<kind_t::set>(ptr, content_offset, elements);
+        } else {
+            record<kind_t::push>(ptr, content_offset, elements);
+        }
+        if (elements) {
+            frames_.push_back(details::frame_t{elements, false});
+        } else {
+            element_parsed(position_ + at);
         }
-        // wrong introduction;
-        return protocol_error_t{
-            Error::make_error_code(bredis_errors::wrong_intoduction)};
     }
-};
+    position_ += at;
+    return at;
+}
 
-template <typename Policy>
-parse_result_t<Policy> raw_parse(std::string_view view) {
-    auto primary =
-        construct_primary_parcer_t<Policy>::apply(view);
-    return std::visit(
-        unwrap_primary_parser_t<Policy>(view), primary);
+template <typename Policy, typename Recorder>
+template <typename ConstBufferSequence>
+std::size_t ResumableParser<Policy, Recorder>::advance_buffers(
+    const ConstBufferSequence &buffers) {
+    namespace asio = boost::asio;
+
+    auto initial_position = position_;
+    // offset of the current buffer since the buffer start
+    std::size_t start = 0;
+    gathered_.clear();
+    auto it = asio::buffer_sequence_begin(buffers);
+    auto end = asio::buffer_sequence_end(buffers);
+    for (; it != end && !complete(); ++it) {
+        asio::const_buffer buffer(*it);
+        std::string_view view{static_cast<const char *>(buffer.data()),
+                              buffer.size()};
+        auto finish = start + view.size();
+        if (gathered_.empty() && finish <= position_) {
+            start = finish;
+            continue;
+        }
+
+        std::size_t at = gathered_.empty() ? position_ - start : 0;
+        while (at < view.size() && !complete()) {
+            if (gathered_.empty()) {
+                at += advance(view.substr(at));
+                if (at < view.size() && !complete()) {
+                    // incomplete element at the end of the buffer
+                    gathered_.assign(view.data() + at, view.size() - at);
+                    at = view.size();
+                }
+            } else {
+                // the header line is gathered up to the next line feed
+                auto line_feed = view.find('\n', at);
+                auto until = line_feed == std::string_view::npos
+                                 ? view.size()
+                                 : line_feed + 1;
+                gathered_.append(view.data() + at, until - at);
+                at = until;
+                gathered_.erase(0, advance(gathered_));
+            }
+        }
+        start = finish;
+    }
+    return position_ - initial_position;
 }
 
-} // namespace details
+template <typename Policy, typename Recorder>
+parse_result_mapper_t<Policy>
+ResumableParser<Policy, Recorder>::result(const char *buffer) {
+    return recorder_.result(buffer, replies_count_, consumed_ - start_);
+}
 
-template <typename Policy>
-parse_result_t<Policy> Protocol::parse(std::string_view view) {
-    return details::raw_parse<Policy>(view);
+template <typename Policy, typename Recorder>
+void ResumableParser<Policy, Recorder>::result(
+    const char *buffer, parse_result_mapper_t<Policy> &into) {
+    recorder_.result(buffer, replies_count_, consumed_ - start_, into);
 }
 
 std::ostream &Protocol::serialize(std::ostream &buff,
@@ -381,4 +812,166 @@ std::ostream &Protocol::serialize(std::ostream &buff,
     return buff;
 }
 
+namespace details {
+
+constexpr std::size_t digits_count(std::size_t value) {
+    std::size_t count = 1;
+    while (value >= 10) {
+        value /= 10;
+        ++count;
+    }
+    return count;
+}
+
+constexpr std::size_t header_size(std::size_t value) {
+    return 1 + digits_count(value) + terminator.size();
+}
+
+// the output must have room for header_size(value) bytes
+inline char *write_header(char *out, char introduction, std::size_t value) {
+    *out++ = introduction;
+    out = std::to_chars(out, out + digits_count(value), value).ptr;
+    out[0] = terminator[0];
+    out[1] = terminator[1];
+    return out + terminator.size();
+}
+
+inline std::size_t serialized_size(const single_command_t &cmd) {
+    auto size = header_size(cmd.arguments.size());
+    for (const auto &arg : cmd.arguments) {
+        size += header_size(arg.size()) + arg.size() + terminator.size();
+    }
+    return size;
+}
+
+inline char *write_command(char *out, const single_command_t &cmd) {
+    out = write_header(out, '*', cmd.arguments.size());
+    for (const auto &arg : cmd.arguments) {
+        out = write_header(out, '$', arg.size());
+        std::memcpy(out, arg.data(), arg.size());
+        out += arg.size();
+        out[0] = terminator[0];
+        out[1] = terminator[1];
+        out += terminator.size();
+    }
+    return out;
+}
+
+// the commands of the wrapper as a plain range
+inline std::pair<const single_command_t *, std::size_t>
+commands_of(const command_wrapper_t &command) {
+    if (auto *single = std::get_if<single_command_t>(&command)) {
+        return {single, 1};
+    }
+    auto &container = std::get<command_container_t>(command);
+    return {container.data(), container.size()};
+}
+
+template <typename DynamicBuffer>
+std::size_t serialize_commands(DynamicBuffer &buff,
+                               const single_command_t *commands,
+                               std::size_t count) {
+    namespace asio = boost::asio;
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        size += serialized_size(commands[i]);
+    }
+    auto buffers = buff.prepare(size);
+    auto first = asio::mutable_buffer(*asio::buffer_sequence_begin(buffers));
+    if (first.size() >= size) {
+        auto out = static_cast<char *>(first.data());
+        for (std::size_t i = 0; i < count; ++i) {
+            out = write_command(out, commands[i]);
+        }
+    } else {
+        // the prepared space is not contiguous
+        std::string serialized(size, '\0');
+        auto out = serialized.data();
+        for (std::size_t i = 0; i < count; ++i) {
+            out = write_command(out, commands[i]);
+        }
+        asio::buffer_copy(buffers, asio::buffer(serialized));
+    }
+    buff.commit(size);
+    return size;
+}
+
+} // namespace details
+
+std::size_t Protocol::serialized_size(const command_wrapper_t &command) {
+    auto [commands, count] = details::commands_of(command);
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        size += details::serialized_size(commands[i]);
+    }
+    return size;
+}
+
+template <typename DynamicBuffer>
+std::size_t Protocol::serialize_into(DynamicBuffer &buff,
+                                     const command_wrapper_t &command) {
+    auto [commands, count] = details::commands_of(command);
+    return details::serialize_commands(buff, commands, count);
+}
+
+command_buffers_t::command_buffers_t(const command_wrapper_t &command)
+    : content_(std::make_shared<content_t>()) {
+    auto [commands, count] = details::commands_of(command);
+
+    // the inlined part is sized in advance, so the buffers pointing to it
+    // remain valid while it is filled
+    std::size_t inlined = 0;
+    std::size_t referenced = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto &arguments = commands[i].arguments;
+        inlined += details::header_size(arguments.size());
+        for (const auto &arg : arguments) {
+            inlined += details::header_size(arg.size()) + terminator.size();
+            if (arg.size() <= BREDIS_INLINE_ARGUMENT_SIZE) {
+                inlined += arg.size();
+            } else {
+                ++referenced;
+            }
+        }
+    }
+    content_->inlined.resize(inlined);
+    content_->buffers.reserve(referenced * 2 + 1);
+
+    auto *out = content_->inlined.data();
+    auto *run_start = out;
+    auto flush = [&]() {
+        if (out > run_start) {
+            content_->buffers.emplace_back(run_start, out - run_start);
+            content_->size += out - run_start;
+            run_start = out;
+        }
+    };
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto &cmd = commands[i];
+        if (std::all_of(cmd.arguments.begin(), cmd.arguments.end(),
+                        [](const auto &arg) {
+                            return arg.size() <= BREDIS_INLINE_ARGUMENT_SIZE;
+                        })) {
+            out = details::write_command(out, cmd);
+            continue;
+        }
+        out = details::write_header(out, '*', cmd.arguments.size());
+        for (const auto &arg : cmd.arguments) {
+            out = details::write_header(out, '$', arg.size());
+            if (arg.size() <= BREDIS_INLINE_ARGUMENT_SIZE) {
+                std::memcpy(out, arg.data(), arg.size());
+                out += arg.size();
+            } else {
+                flush();
+                content_->buffers.emplace_back(arg.data(), arg.size());
+                content_->size += arg.size();
+            }
+            out[0] = terminator[0];
+            out[1] = terminator[1];
+            out += terminator.size();
+        }
+    }
+    flush();
+}
+
 } // namespace bredis
@@ -0,0 +1,251 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+#pragma once
+
+#include <algorithm>
+
+#include <boost/asio.hpp>
+
+#include "common.ipp"
+
+namespace bredis {
+
+void bulk_stream_t::reset() {
+    state_ = state_t::header;
+    size_ = 0;
+    left_ = 0;
+    error_ = protocol_error_t{};
+}
+
+void bulk_stream_t::skip(std::size_t bytes) {
+    left_ -= bytes;
+    if (!left_) {
+        state_ = state_t::terminator;
+    }
+}
+
+template <typename ConstBufferSequence, typename ChunkCallback>
+std::size_t bulk_stream_t::advance(const ConstBufferSequence &buffers,
+                                   ChunkCallback &&chunk_callback) {
+    namespace asio = boost::asio;
+    // '$', 19 digits and terminator
+    constexpr std::size_t max_header = 22;
+
+    std::size_t available = asio::buffer_size(buffers);
+    std::size_t consumed = 0;
+    if (state_ == state_t::header) {
+        char header[max_header];
+        auto size = std::min(available, max_header);
+        std::copy_n(asio::buffers_begin(buffers), size, header);
+        std::string_view line{header, size};
+        if (line.empty()) {
+            return 0;
+        } else if (line[0] != '$') {
+            state_ = state_t::not_streamed;
+            return 0;
+        }
+        auto found_terminator = line.find(terminator);
+        if (found_terminator == std::string_view::npos) {
+            if (size == max_header) {
+                // malformed count is reported by the parser
+                state_ = state_t::not_streamed;
+            }
+            return 0;
+        }
+        auto count_result =
+            details::parse_count(line.substr(1, found_terminator - 1));
+        auto *count = std::get_if<long>(&count_result);
+        if (!count || *count < 0) {
+            state_ = state_t::not_streamed;
+            return 0;
+        }
+        size_ = left_ = static_cast<std::size_t>(*count);
+        consumed = found_terminator + terminator.size();
+        state_ = state_t::payload;
+    }
+
+    if (state_ == state_t::payload) {
+        // the chunks are delivered right from the buffers
+        std::size_t start = 0;
+        auto it = asio::buffer_sequence_begin(buffers);
+        auto end = asio::buffer_sequence_end(buffers);
+        for (; it != end && left_; ++it) {
+            asio::const_buffer buffer(*it);
+            auto finish = start + buffer.size();
+            if (finish > consumed) {
+                auto from = consumed - start;
+                auto size = std::min(buffer.size() - from, left_);
+                left_ -= size;
+                consumed += size;
+                chunk_callback(
+                    std::string_view{
+                        static_cast<const char *>(buffer.data()) + from, size},
+                    left_);
+            }
+            start = finish;
+        }
+        if (left_) {
+            return consumed;
+        }
+        state_ = state_t::terminator;
+    }
+
+    if (state_ == state_t::terminator) {
+        if (available - consumed < terminator.size()) {
+            return consumed;
+        }
+        char tail[2];
+        std::copy_n(asio::buffers_begin(buffers) + consumed, 2, tail);
+        if (std::string_view{tail, 2} != terminator) {
+            error_ = Error::make_error_code(bredis_errors::bulk_terminator);
+            return consumed;
+        }
+        consumed += terminator.size();
+        state_ = state_t::done;
+    }
+    return consumed;
+}
+
+void aggregate_stream_t::reset(std::size_t depth) {
+    depth_ = std::min<std::size_t>(depth, BREDIS_MAX_NESTING_DEPTH);
+    state_ = state_t::header;
+    kind_ = markers::tape_kind_t::array;
+    count_ = 0;
+    frames_.clear();
+    element_start_ = 0;
+    error_ = protocol_error_t{};
+}
+
+void aggregate_stream_t::element_parsed() {
+    while (!frames_.empty()) {
+        if (--frames_.back()) {
+            state_ = state_t::header;
+            return;
+        }
+        frames_.pop_back();
+    }
+    state_ = state_t::done;
+}
+
+template <typename ConstBufferSequence, typename ElementCallback>
+std::size_t aggregate_stream_t::advance(const ConstBufferSequence &buffers,
+                                        ElementCallback &&element_callback) {
+    namespace asio = boost::asio;
+    // introduction, 19 digits and terminator
+    constexpr std::size_t max_header = 22;
+
+    if (state_ == state_t::element && element_start_) {
+        // the bytes before the incomplete element have been consumed
+        parser_.rebase(1, false);
+        element_start_ = 0;
+    }
+
+    std::size_t available = asio::buffer_size(buffers);
+    std::size_t consumed = 0;
+    while (!complete()) {
+        if (state_ == state_t::element) {
+            parser_.advance_buffers(buffers);
+            if (!parser_.complete()) {
+                return consumed;
+            } else if (parser_.error()) {
+                error_ = parser_.error();
+                return consumed;
+            }
+            parser_.result(details::buffer_base<policy_t>(buffers), element_);
+            const markers::redis_result_t &element = element_.result;
+            element_callback(element);
+            consumed += element_.consumed;
+            ++count_;
+            element_parsed();
+            continue;
+        }
+
+        char header[max_header];
+        auto size = std::min(available - consumed, max_header);
+        std::copy_n(asio::buffers_begin(buffers) + consumed, size, header);
+        std::string_view line{header, size};
+        if (line.empty()) {
+            return consumed;
+        }
+
+        long count = -1;
+        auto found_terminator = line.find(terminator);
+        switch (line[0]) {
+        case '*':
+        case '%':
+        case '~':
+        case '>':
+            if (frames_.size() < depth_) {
+                if (found_terminator == std::string_view::npos) {
+                    if (size < max_header) {
+                        return consumed;
+                    }
+                    // malformed count is reported by the parser
+                    break;
+                }
+                auto count_result =
+                    details::parse_count(line.substr(1, found_terminator - 1));
+                if (auto *value = std::get_if<long>(&count_result); value) {
+                    count = *value;
+                }
+            }
+            break;
+        }
+
+        // empty aggregates are opened only at the top level
+        if (count < 0 || (count == 0 && !frames_.empty())) {
+            if (frames_.empty()) {
+                state_ = state_t::not_streamed;
+                return consumed;
+            }
+            parser_.reset(1, consumed);
+            element_start_ = consumed;
+            state_ = state_t::element;
+            continue;
+        }
+
+        if (frames_.empty()) {
+            switch (line[0]) {
+            case '%':
+                kind_ = markers::tape_kind_t::map;
+                break;
+            case '~':
+                kind_ = markers::tape_kind_t::set;
+                break;
+            case '>':
+                kind_ = markers::tape_kind_t::push;
+                break;
+            }
+        }
+        consumed += found_terminator + terminator.size();
+        auto elements = static_cast<std::size_t>(count);
+        if (line[0] == '%') {
+            elements *= 2;
+        }
+        if (elements) {
+            frames_.push_back(elements);
+        } else {
+            state_ = state_t::done;
+        }
+    }
+    return consumed;
+}
+
+markers::redis_result_t aggregate_stream_t::streamed_marker() const {
+    switch (kind_) {
+    case markers::tape_kind_t::map:
+        return markers::map_holder_t{};
+    case markers::tape_kind_t::set:
+        return markers::set_holder_t{};
+    case markers::tape_kind_t::push:
+        return markers::push_holder_t{};
+    default:
+        return markers::array_holder_t{};
+    }
+}
+
+} // namespace bredis
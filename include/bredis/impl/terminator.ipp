@@ -0,0 +1,143 @@
+//
+//
+// Copyright (c) 2017 Ivan Baidakou (basiliscos) (the dot dmol at gmail dot com)
+//
+// Distributed under the MIT Software License
+//
+#pragma once
+
+#include <cstring>
+#include <string_view>
+
+#if !defined(BREDIS_DISABLE_SIMD)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) &&        \
+    defined(__SSE2__)
+#define BREDIS_SIMD_SSE2
+#define BREDIS_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || (_M_IX86_FP >= 2))
+#define BREDIS_SIMD_SSE2
+#include <emmintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+namespace bredis {
+
+namespace details {
+
+// Locates "\r\n" in the view starting from the position from; returns
+// std::string_view::npos if it is not found. The first byte of each pair
+// is compared to '\r' and the byte next to it to '\n' for the whole
+// vector register at once; AVX2 is used only if CPU supports it
+// (checked at run-time), otherwise SSE2 or scalar code is used.
+
+inline std::size_t find_terminator_scalar(const char *data, std::size_t from,
+                                          std::size_t size) {
+    while (from + 1 < size) {
+        auto found = static_cast<const char *>(
+            std::memchr(data + from, '\r', size - from - 1));
+        if (!found) {
+            break;
+        }
+        from = static_cast<std::size_t>(found - data);
+        if (data[from + 1] == '\n') {
+            return from;
+        }
+        ++from;
+    }
+    return std::string_view::npos;
+}
+
+#if defined(BREDIS_SIMD_SSE2)
+inline int terminator_mask_sse2(const char *ptr) {
+    auto cr = _mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr)),
+        _mm_set1_epi8('\r'));
+    auto lf = _mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + 1)),
+        _mm_set1_epi8('\n'));
+    return _mm_movemask_epi8(_mm_and_si128(cr, lf));
+}
+
+inline int count_trailing_zeros(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+#if defined(BREDIS_SIMD_AVX2)
+// from is updated to the position, where the search should be continued
+__attribute__((target("avx2"))) inline std::size_t
+find_terminator_avx2(const char *data, std::size_t &from, std::size_t size) {
+    const auto cr = _mm256_set1_epi8('\r');
+    const auto lf = _mm256_set1_epi8('\n');
+    // the last loaded byte is at from + 32, which must be inside
+    for (; from + 33 <= size; from += 32) {
+        auto ptr = data + from;
+        auto cr_mask = _mm256_cmpeq_epi8(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr)), cr);
+        auto lf_mask = _mm256_cmpeq_epi8(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr + 1)),
+            lf);
+        unsigned mask = static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_and_si256(cr_mask, lf_mask)));
+        if (mask) {
+            return from + __builtin_ctz(mask);
+        }
+    }
+    return std::string_view::npos;
+}
+
+inline bool cpu_supports_avx2() {
+    static const bool supports = __builtin_cpu_supports("avx2");
+    return supports;
+}
+#endif
+
+inline std::size_t find_terminator(std::string_view view, std::size_t from) {
+    const char *data = view.data();
+    std::size_t size = view.size();
+
+#if defined(BREDIS_SIMD_SSE2)
+    // the most of header lines are short and fit into the first block
+    if (from + 17 <= size) {
+        unsigned mask =
+            static_cast<unsigned>(terminator_mask_sse2(data + from));
+        if (mask) {
+            return from + count_trailing_zeros(mask);
+        }
+        from += 16;
+    }
+#endif
+
+#if defined(BREDIS_SIMD_AVX2)
+    if (from + 33 <= size && cpu_supports_avx2()) {
+        auto found = find_terminator_avx2(data, from, size);
+        if (found != std::string_view::npos) {
+            return found;
+        }
+    }
+#endif
+
+#if defined(BREDIS_SIMD_SSE2)
+    for (; from + 17 <= size; from += 16) {
+        unsigned mask =
+            static_cast<unsigned>(terminator_mask_sse2(data + from));
+        if (mask) {
+            return from + count_trailing_zeros(mask);
+        }
+    }
+#endif
+
+    return find_terminator_scalar(data, from, size);
+}
+
+} // namespace details
+
+} // namespace bredis
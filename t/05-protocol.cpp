@@ -1,7 +1,15 @@
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
 #include <vector>
 
+#include "bredis/CommandBatch.hpp"
 #include "bredis/MarkerHelpers.hpp"
+#include "bredis/PreparedCommand.hpp"
 #include "bredis/Protocol.hpp"
+#include "bredis/StaticCommand.hpp"
+#include "bredis/Stream.hpp"
 #include "catch.hpp"
 
 namespace r = bredis;
@@ -34,7 +42,7 @@ TEST_CASE("non-finished ", "[protocol]") {
 };
 
 TEST_CASE("wrong start marker", "[protocol]") {
-    std::string ok = "!OK";
+    std::string ok = "@OK";
     auto parsed_result = r::Protocol::parse(ok);
     r::protocol_error_t *r = std::get_if<r::protocol_error_t>(&parsed_result);
     REQUIRE(r->message() == "Wrong introduction");
@@ -172,6 +180,17 @@ TEST_CASE("malformed bulk string(4)", "[protocol]") {
     REQUIRE(r->message() == "Cannot convert count to number");
 };
 
+TEST_CASE("malformed bulk string(5)", "[protocol]") {
+    for (std::string ok : {"$4a\r\nsome\r\n", "$\r\n", "$-\r\n", "$ 4\r\n",
+                           "$9223372036854775808\r\n"}) {
+        auto parsed_result = r::Protocol::parse(ok);
+        r::protocol_error_t *r =
+            std::get_if<r::protocol_error_t>(&parsed_result);
+        REQUIRE(r != nullptr);
+        REQUIRE(r->message() == "Cannot convert count to number");
+    }
+};
+
 TEST_CASE("empty array", "[protocol]") {
     std::string ok = "*0\r\n";
     auto parsed_result = r::Protocol::parse(ok);
@@ -378,6 +397,28 @@ TEST_CASE("overfilled buffer", "[protocol]") {
             nullptr);
 }
 
+TEST_CASE("inline arguments of command", "[protocol]") {
+    auto is_inline = [](const r::single_command_t &cmd) {
+        auto data = reinterpret_cast<const char *>(cmd.arguments.data());
+        auto self = reinterpret_cast<const char *>(&cmd);
+        return data >= self && data < self + sizeof(cmd);
+    };
+
+    r::single_command_t get{"GET", "key"};
+    REQUIRE(is_inline(get));
+    auto copy = get;
+    REQUIRE(is_inline(copy));
+    REQUIRE(copy.arguments[1] == "key");
+
+    std::vector<std::string> items(BREDIS_INLINE_ARGUMENTS + 1, "item");
+    items[0] = "RPUSH";
+    r::single_command_t rpush(items.cbegin(), items.cend());
+    REQUIRE(!is_inline(rpush));
+    REQUIRE(rpush.arguments.size() == items.size());
+    rpush.arguments.emplace_back("last");
+    REQUIRE(rpush.arguments.back() == "last");
+};
+
 TEST_CASE("serialize", "[protocol]") {
     std::stringstream buff;
     r::single_command_t cmd("LLEN", "fmm.cheap-travles2");
@@ -385,3 +426,1016 @@ TEST_CASE("serialize", "[protocol]") {
     std::string expected("*2\r\n$4\r\nLLEN\r\n$18\r\nfmm.cheap-travles2\r\n");
     REQUIRE(buff.str() == expected);
 };
+
+TEST_CASE("serialize into buffers", "[protocol]") {
+    auto gather = [](const r::command_buffers_t &buffers) {
+        std::string content;
+        for (const auto &buffer : buffers) {
+            content.append(static_cast<const char *>(buffer.data()),
+                           buffer.size());
+        }
+        REQUIRE(content.size() == buffers.size());
+        return content;
+    };
+
+    r::single_command_t cmd("LLEN", "fmm.cheap-travles2");
+    r::command_buffers_t buffers(cmd);
+    REQUIRE(std::distance(buffers.begin(), buffers.end()) == 1);
+    std::string expected("*2\r\n$4\r\nLLEN\r\n$18\r\nfmm.cheap-travles2\r\n");
+    REQUIRE(gather(buffers) == expected);
+
+    /* the large arguments are not copied */
+    std::string big(BREDIS_INLINE_ARGUMENT_SIZE + 1, 'x');
+    r::command_container_t cmds{r::single_command_t{"SET", "a", big},
+                                r::single_command_t{"SET", "b", big},
+                                r::single_command_t{"GET", "a"}};
+    r::command_buffers_t big_buffers(cmds);
+    std::stringstream buff;
+    for (const auto &c : cmds) {
+        r::Protocol::serialize(buff, c);
+    }
+    REQUIRE(gather(big_buffers) == buff.str());
+    std::vector<boost::asio::const_buffer> parts(big_buffers.begin(),
+                                                 big_buffers.end());
+    REQUIRE(parts.size() == 5);
+    REQUIRE(parts[1].data() == big.data());
+    REQUIRE(parts[3].data() == big.data());
+
+    /* the copies share the content */
+    auto copy = big_buffers;
+    REQUIRE(copy.begin()->data() == big_buffers.begin()->data());
+};
+
+TEST_CASE("serialize into dynamic buffer", "[protocol]") {
+    std::string value(1234, 'v');
+    r::command_container_t cmds{r::single_command_t{"SET", "key", value},
+                                r::single_command_t{"GET", "key"},
+                                r::single_command_t{"PING"}};
+    std::stringstream expected;
+    for (const auto &c : cmds) {
+        r::Protocol::serialize(expected, c);
+    }
+    REQUIRE(r::Protocol::serialized_size(cmds) == expected.str().size());
+
+    boost::asio::streambuf buff;
+    auto size = r::Protocol::serialize_into(buff, cmds);
+    REQUIRE(size == expected.str().size());
+    std::string content(boost::asio::buffers_begin(buff.data()),
+                        boost::asio::buffers_end(buff.data()));
+    REQUIRE(content == expected.str());
+
+    /* appended to the existing content */
+    std::string str("prefix");
+    auto str_buff = boost::asio::dynamic_buffer(str);
+    r::single_command_t cmd("LLEN", "fmm.cheap-travles2");
+    r::Protocol::serialize_into(str_buff, cmd);
+    REQUIRE(str ==
+            "prefix*2\r\n$4\r\nLLEN\r\n$18\r\nfmm.cheap-travles2\r\n");
+};
+
+TEST_CASE("prepared command", "[protocol]") {
+    auto gather = [](const r::prepared_command_t &command) {
+        std::string content;
+        for (const auto &buffer : command) {
+            content.append(static_cast<const char *>(buffer.data()),
+                           buffer.size());
+        }
+        REQUIRE(content.size() == command.size());
+        return content;
+    };
+    auto serialize = [](const r::single_command_t &cmd) {
+        std::stringstream buff;
+        r::Protocol::serialize(buff, cmd);
+        return buff.str();
+    };
+
+    r::prepared_command_t hincrby({"HINCRBY", "h", "", "1"}, {2});
+    REQUIRE(hincrby.arity() == 1);
+    REQUIRE(gather(hincrby.bind("field")) ==
+            serialize({"HINCRBY", "h", "field", "1"}));
+    std::string big(12345, 'f');
+    REQUIRE(gather(hincrby.bind(big)) == serialize({"HINCRBY", "h", big, "1"}));
+    REQUIRE(gather(hincrby.bind("")) == serialize({"HINCRBY", "h", "", "1"}));
+
+    r::prepared_command_t set({"SET", "", ""}, {1, 2});
+    REQUIRE(gather(set.bind("k", "value")) == serialize({"SET", "k", "value"}));
+
+    r::prepared_command_t ping({"PING"}, {});
+    REQUIRE(gather(ping) == serialize({"PING"}));
+
+    /* the buffers refer the own encoding of the copied or moved command */
+    auto moved_ping = std::move(ping);
+    REQUIRE(gather(moved_ping) == serialize({"PING"}));
+    std::string value = "value";
+    std::optional<r::prepared_command_t> original(
+        r::prepared_command_t({"SET", "k", ""}, {2}));
+    original->bind(value);
+    r::prepared_command_t copy(*original);
+    r::prepared_command_t assigned({"PING"}, {});
+    assigned = *original;
+    original.reset();
+    REQUIRE(gather(copy) == serialize({"SET", "k", "value"}));
+    REQUIRE(gather(assigned) == serialize({"SET", "k", "value"}));
+    auto moved = std::move(copy);
+    REQUIRE(gather(moved) == serialize({"SET", "k", "value"}));
+    REQUIRE(gather(moved.bind("other")) == serialize({"SET", "k", "other"}));
+
+    /* the count of values must match the arity */
+    REQUIRE_THROWS_AS(moved.bind("a", "b"), const std::invalid_argument &);
+    REQUIRE_THROWS_AS(set.bind("k"), const std::invalid_argument &);
+    REQUIRE_THROWS_AS(set.bind(), const std::invalid_argument &);
+    REQUIRE(gather(set.bind("k", "v")) == serialize({"SET", "k", "v"}));
+};
+
+TEST_CASE("static command", "[protocol]") {
+    auto gather = [](const auto &command) {
+        std::string content;
+        for (const auto &buffer : command.buffers()) {
+            content.append(static_cast<const char *>(buffer.data()),
+                           buffer.size());
+        }
+        REQUIRE(content.size() == command.size());
+        return content;
+    };
+    auto serialize = [](const r::single_command_t &cmd) {
+        std::stringstream buff;
+        r::Protocol::serialize(buff, cmd);
+        return buff.str();
+    };
+
+    constexpr auto &prefix =
+        r::details::static_prefix<r::commands::hgetall, 1>::value;
+    static_assert(std::string_view(prefix.data(), prefix.size()) ==
+                  "*2\r\n$7\r\nHGETALL\r\n");
+
+    std::string value(1000, 'v');
+    REQUIRE(gather(r::cmd<r::commands::set>("key", value)) ==
+            serialize({"SET", "key", value}));
+    REQUIRE(gather(r::cmd<r::commands::set>("key", value, "EX", "10")) ==
+            serialize({"SET", "key", value, "EX", "10"}));
+    REQUIRE(gather(r::cmd<r::commands::ping>()) == serialize({"PING"}));
+
+    /* the copy refers the same arguments */
+    auto get = r::cmd<r::commands::get>("key");
+    decltype(get) copy(get);
+    REQUIRE(gather(copy) == serialize({"GET", "key"}));
+};
+
+TEST_CASE("command batch", "[protocol]") {
+    r::command_batch_t batch;
+    std::stringstream expected;
+    for (auto i = 0; i < 100; ++i) {
+        /* the arguments are temporaries */
+        batch.add("SET", "key:" + std::to_string(i), std::to_string(i * i));
+        r::Protocol::serialize(expected, {"SET", "key:" + std::to_string(i),
+                                          std::to_string(i * i)});
+    }
+    batch.add(r::single_command_t{"GET", "key:0"});
+    r::Protocol::serialize(expected, {"GET", "key:0"});
+
+    REQUIRE(batch.commands() == 101);
+    auto buffer = batch.buffers();
+    REQUIRE(buffer.size() == batch.size());
+    REQUIRE(std::string(static_cast<const char *>(buffer.data()),
+                        buffer.size()) == expected.str());
+
+    batch.clear();
+    REQUIRE(batch.empty());
+    REQUIRE(batch.size() == 0);
+};
+
+namespace custom {
+struct point_t {
+    int x;
+    int y;
+};
+
+void bredis_format(std::string &out, const point_t &value) {
+    out += std::to_string(value.x) + ',' + std::to_string(value.y);
+}
+} // namespace custom
+
+TEST_CASE("command batch: typed arguments", "[protocol]") {
+    r::command_batch_t batch;
+    std::vector<std::uint8_t> bytes{0, 1, 255};
+    batch.add("ZADD", "scores", 1.5, "a", -42, "b", 0.1, "c")
+        .add("EXPIRE", "scores", 3600u)
+        .add("SET", "raw", boost::asio::buffer(bytes))
+        .add("SET", "point", custom::point_t{3, -4});
+
+    std::stringstream expected;
+    r::Protocol::serialize(
+        expected, {"ZADD", "scores", "1.5", "a", "-42", "b", "0.1", "c"});
+    r::Protocol::serialize(expected, {"EXPIRE", "scores", "3600"});
+    std::string raw(bytes.begin(), bytes.end());
+    r::Protocol::serialize(expected, {"SET", "raw", raw});
+    r::Protocol::serialize(expected, {"SET", "point", "3,-4"});
+
+    REQUIRE(batch.commands() == 4);
+    auto buffer = batch.buffers();
+    REQUIRE(std::string(static_cast<const char *>(buffer.data()),
+                        buffer.size()) == expected.str());
+
+    /* the shortest round-trip representation */
+    r::command_batch_t doubles;
+    doubles.add(1.0 / 3);
+    std::string third("*1\r\n$18\r\n0.3333333333333333\r\n");
+    REQUIRE(std::string(static_cast<const char *>(doubles.buffers().data()),
+                        doubles.size()) == third);
+};
+
+TEST_CASE("dropped replies: errors", "[protocol]") {
+    using Policy = r::parsing_policy::drop_result;
+    std::string replies = "+OK\r\n-ERR first\r\n*2\r\n-ERR nested\r\n:1\r\n"
+                          "-ERR second\r\n$3\r\nabc\r\n";
+
+    /* fed byte by byte */
+    r::ResumableParser<Policy> parser(5);
+    for (std::size_t i = 1; i <= replies.size(); ++i) {
+        std::string_view view(replies.data(), i);
+        parser.advance(view.substr(parser.position()));
+    }
+    REQUIRE(parser.complete());
+    auto result = parser.result(replies.data());
+    REQUIRE(result.consumed == replies.size());
+    REQUIRE(result.replies == 5);
+    REQUIRE(result.errors == 2);
+    REQUIRE(result.first_error_index == 1);
+    REQUIRE(result.first_error == "ERR first");
+
+    auto positive =
+        std::get<r::positive_parse_result_t<Policy>>(r::Protocol::parse<Policy>(
+            "+OK\r\n"));
+    REQUIRE(positive.replies == 1);
+    REQUIRE(positive.errors == 0);
+    REQUIRE(positive.first_error.empty());
+};
+
+TEST_CASE("command batch: suppressed replies", "[protocol]") {
+    r::command_batch_t batch;
+    batch.add("SET", "a", 1).add_without_reply("SET", "b", 2).reply_off();
+    batch.add("SET", "c", 3).add_without_reply("SET", "d", 4).reply_on();
+    REQUIRE(batch.commands() == 7);
+    REQUIRE(batch.replies() == 2);
+    REQUIRE(batch.replying());
+
+    std::stringstream expected;
+    for (auto cmd : {r::single_command_t{"SET", "a", "1"},
+                     r::single_command_t{"CLIENT", "REPLY", "SKIP"},
+                     r::single_command_t{"SET", "b", "2"},
+                     r::single_command_t{"CLIENT", "REPLY", "OFF"},
+                     r::single_command_t{"SET", "c", "3"},
+                     r::single_command_t{"SET", "d", "4"},
+                     r::single_command_t{"CLIENT", "REPLY", "ON"}}) {
+        r::Protocol::serialize(expected, cmd);
+    }
+    auto buffer = batch.buffers();
+    REQUIRE(std::string(static_cast<const char *>(buffer.data()),
+                        buffer.size()) == expected.str());
+
+    /* the reply mode persists */
+    batch.reply_off().clear();
+    batch.add("SET", "e", 5);
+    REQUIRE(batch.replies() == 0);
+    REQUIRE(!batch.replying());
+};
+
+TEST_CASE("resumable parser: byte by byte", "[protocol]") {
+    std::string reply_1 = "*2\r\n*3\r\n:1\r\n:2\r\n:3\r\n*2\r\n+Foo\r\n$3\r\nBar\r\n";
+    std::string reply_2 = "$-1\r\n";
+    std::string reply_3 = "+OK\r\n";
+    std::string ok = reply_1 + reply_2 + reply_3;
+    r::ResumableParser<Policy> parser(2);
+    std::size_t examined = 0;
+    for (std::size_t i = 1; i <= ok.size() && !parser.complete(); ++i) {
+        std::string_view view(ok.data(), i);
+        examined += parser.advance(view.substr(parser.position()));
+        REQUIRE(parser.position() == examined);
+    }
+    REQUIRE(parser.complete());
+    REQUIRE(!parser.error());
+    REQUIRE(parser.replies_count() == 2);
+    REQUIRE(parser.consumed() == reply_1.size() + reply_2.size());
+    REQUIRE(parser.position() == parser.consumed());
+};
+
+TEST_CASE("resumable parser: explicit wrapping", "[protocol]") {
+    std::string ok = "+OK\r\n";
+    r::ResumableParser<Policy> parser;
+    parser.reset(1, 0, true);
+    parser.advance(ok);
+    REQUIRE(parser.complete());
+    auto result = parser.result(ok.data());
+    auto &replies = std::get<r::markers::array_holder_t>(result.result);
+    REQUIRE(replies.elements.size() == 1);
+    REQUIRE(std::visit(r::marker_helpers::equality("OK"),
+                       replies.elements[0]));
+    REQUIRE(result.consumed == ok.size());
+
+    parser.reset(1);
+    parser.advance(ok);
+    result = parser.result(ok.data());
+    REQUIRE(std::visit(r::marker_helpers::equality("OK"), result.result));
+};
+
+TEST_CASE("resumable parser: partial bulk string", "[protocol]") {
+    std::string ok = "$10\r\n0123456789\r\n";
+    r::ResumableParser<Policy> parser;
+    std::string_view view(ok);
+
+    REQUIRE(parser.advance(view.substr(0, 7)) == 7);
+    REQUIRE(!parser.complete());
+    REQUIRE(parser.consumed() == 0);
+
+    /* the payload is skipped, but not the incomplete terminator */
+    REQUIRE(parser.advance(view.substr(7, 9)) == 8);
+    REQUIRE(!parser.complete());
+
+    REQUIRE(parser.advance(view.substr(parser.position())) == 2);
+    REQUIRE(parser.complete());
+    REQUIRE(!parser.error());
+    REQUIRE(parser.consumed() == ok.size());
+};
+
+TEST_CASE("resumable parser: protocol errors", "[protocol]") {
+    r::ResumableParser<r::parsing_policy::drop_result> parser;
+    parser.advance("@OK");
+    REQUIRE(parser.complete());
+    REQUIRE(parser.error().message() == "Wrong introduction");
+
+    parser.reset(1);
+    parser.advance("$4\r\nsomemm");
+    REQUIRE(parser.complete());
+    REQUIRE(parser.error().message() == "Terminator for bulk string not found");
+
+    parser.reset(1);
+    parser.advance("*-4\r\n");
+    REQUIRE(parser.complete());
+    REQUIRE(parser.error().message() == "Unacceptable count value");
+
+    parser.reset(1);
+    parser.advance("*1\r\n*0\r\n");
+    REQUIRE(parser.complete());
+    REQUIRE(!parser.error());
+    REQUIRE(parser.consumed() == 8);
+};
+
+TEST_CASE("resumable parser: markers of relocated buffer", "[protocol]") {
+    std::string ok = "*3\r\n$4\r\nsome\r\n*2\r\n:5\r\n-Err\r\n$-1\r\n+OK\r\n";
+    r::ResumableParser<Policy> parser(2);
+    std::string buffer;
+    for (std::size_t i = 0; i < ok.size() && !parser.complete(); i += 3) {
+        /* the data is relocated on each chunk arrival */
+        buffer = std::string(buffer) + ok.substr(i, 3);
+        std::string_view view(buffer);
+        parser.advance(view.substr(parser.position()));
+    }
+    REQUIRE(parser.complete());
+    REQUIRE(!parser.error());
+
+    auto positive_parse_result = parser.result(buffer.data());
+    REQUIRE(positive_parse_result.consumed == ok.size());
+    auto &replies =
+        std::get<r::markers::array_holder_t>(positive_parse_result.result);
+    REQUIRE(replies.elements.size() == 2);
+
+    auto &array = std::get<r::markers::array_holder_t>(replies.elements[0]);
+    REQUIRE(array.elements.size() == 3);
+    REQUIRE(std::visit(r::marker_helpers::equality("some"),
+                       array.elements[0]));
+    auto &nested = std::get<r::markers::array_holder_t>(array.elements[1]);
+    REQUIRE(std::get<r::markers::int_t>(nested.elements[0]) == "5");
+    REQUIRE(std::get<r::markers::error_t>(nested.elements[1]) == "Err");
+    REQUIRE(std::get_if<r::markers::nil_t>(&array.elements[2]) != nullptr);
+    REQUIRE(std::visit(r::marker_helpers::equality("OK"),
+                       replies.elements[1]));
+};
+
+TEST_CASE("terminator search", "[protocol]") {
+    /* terminators (and their halves) at all positions relative to
+     * vector register boundaries */
+    for (std::size_t size = 0; size < 100; ++size) {
+        for (std::size_t at = 0; at < size; ++at) {
+            std::string data(size, 'a');
+            data[at] = '\r';
+            if (at + 1 < size) {
+                data[at + 1] = '\n';
+            }
+            if (at > 3) {
+                data[at - 3] = '\r';
+                data[at - 1] = '\n';
+            }
+            std::string_view view(data);
+            for (std::size_t from = 0; from <= std::min<std::size_t>(size, 3);
+                 ++from) {
+                REQUIRE(r::details::find_terminator(view, from) ==
+                        view.find("\r\n", from));
+            }
+        }
+    }
+};
+
+TEST_CASE("nesting depth limit", "[protocol]") {
+    std::string allowed;
+    for (std::size_t i = 0; i < BREDIS_MAX_NESTING_DEPTH; ++i) {
+        allowed += "*1\r\n";
+    }
+    allowed += ":1\r\n";
+    auto parsed_result = r::Protocol::parse(allowed);
+    auto positive_parse_result = std::get<positive_result_t>(parsed_result);
+    REQUIRE(positive_parse_result.consumed == allowed.size());
+
+    const r::markers::redis_result_t *element = &positive_parse_result.result;
+    for (std::size_t i = 0; i < BREDIS_MAX_NESTING_DEPTH; ++i) {
+        auto &array = std::get<r::markers::array_holder_t>(*element);
+        REQUIRE(array.elements.size() == 1);
+        element = &array.elements[0];
+    }
+    REQUIRE(std::get<r::markers::int_t>(*element) == "1");
+
+    std::string too_deep = "*1\r\n" + allowed;
+    parsed_result = r::Protocol::parse(too_deep);
+    r::protocol_error_t *r = std::get_if<r::protocol_error_t>(&parsed_result);
+    REQUIRE(r != nullptr);
+    REQUIRE(r->message() == "Nesting depth limit exceeded");
+
+    auto dropped_result =
+        r::Protocol::parse<r::parsing_policy::drop_result>(too_deep);
+    REQUIRE(std::get_if<r::protocol_error_t>(&dropped_result) != nullptr);
+};
+
+TEST_CASE("huge aggregate count", "[protocol]") {
+    /* the elements are not reserved beyond the limit */
+    std::string huge = "*4000000000\r\n*4000000000\r\n:1\r\n";
+    auto parsed_result = r::Protocol::parse(huge);
+    REQUIRE(std::get_if<r::not_enough_data_t>(&parsed_result) != nullptr);
+
+    auto tape_result =
+        r::Protocol::parse<r::parsing_policy::tape_result>(huge);
+    REQUIRE(std::get_if<r::not_enough_data_t>(&tape_result) != nullptr);
+};
+
+TEST_CASE("tape: array of arrays", "[protocol]") {
+    using TapePolicy = r::parsing_policy::tape_result;
+    std::string ok = "*3\r\n*2\r\n:1\r\n$3\r\nfoo\r\n*0\r\n-Bar\r\n";
+    auto parsed_result = r::Protocol::parse<TapePolicy>(ok);
+    auto &positive_parse_result =
+        std::get<r::parse_result_mapper_t<TapePolicy>>(parsed_result);
+    REQUIRE(positive_parse_result.consumed == ok.size());
+
+    auto &tape = positive_parse_result.result;
+    REQUIRE(tape.entries.size() == 6);
+    REQUIRE(std::distance(tape.begin(), tape.end()) == 1);
+
+    auto root = tape.front();
+    REQUIRE(root.is_array());
+    REQUIRE(root.size() == 3);
+    REQUIRE(std::distance(root.begin(), root.end()) == 3);
+
+    auto it = root.begin();
+    REQUIRE(it->size() == 2);
+    auto nested = it->begin();
+    REQUIRE(nested->kind() == r::markers::tape_kind_t::int_);
+    REQUIRE(nested->str() == "1");
+    ++nested;
+    REQUIRE(nested->kind() == r::markers::tape_kind_t::string);
+    REQUIRE(nested->str() == "foo");
+    REQUIRE(++nested == it->end());
+
+    ++it;
+    REQUIRE(it->is_array());
+    REQUIRE(it->begin() == it->end());
+    ++it;
+    REQUIRE(it->kind() == r::markers::tape_kind_t::error);
+    REQUIRE(r::markers::visit(r::marker_helpers::equality("Bar"), *it));
+    REQUIRE(++it == root.end());
+
+    REQUIRE(r::markers::visit(r::marker_helpers::stringizer(), root) ==
+            "[array] {[array] {[int] 1, [str] foo, }, [array] {}, "
+            "[err] Bar, }");
+};
+
+TEST_CASE("tape: resumable parser with multiple replies", "[protocol]") {
+    using TapePolicy = r::parsing_policy::tape_result;
+    std::string ok = "+OK\r\n*2\r\n$-1\r\n:5\r\n$4\r\nsome\r\n";
+    r::ResumableParser<TapePolicy> parser(3);
+    std::string buffer;
+    for (std::size_t i = 0; i < ok.size() && !parser.complete(); ++i) {
+        /* the data is relocated on each byte arrival */
+        buffer = std::string(buffer) + ok[i];
+        std::string_view view(buffer);
+        parser.advance(view.substr(parser.position()));
+    }
+    REQUIRE(parser.complete());
+    REQUIRE(!parser.error());
+
+    auto positive_parse_result = parser.result(buffer.data());
+    REQUIRE(positive_parse_result.consumed == ok.size());
+    auto &tape = positive_parse_result.result;
+    std::vector<r::markers::tape_cursor_t> replies(tape.begin(), tape.end());
+    REQUIRE(replies.size() == 3);
+    REQUIRE(replies[0].str() == "OK");
+    REQUIRE(replies[1].size() == 2);
+    REQUIRE(replies[1].begin()->kind() == r::markers::tape_kind_t::nil);
+    REQUIRE(replies[2].str() == "some");
+};
+
+TEST_CASE("resumable parser: replies parsed so far", "[protocol]") {
+    using TapePolicy = r::parsing_policy::tape_result;
+    std::string ok = "+OK\r\n*2\r\n:1\r\n$5\r\nso";
+    std::string_view view(ok);
+
+    /* partially parsed array is not the part of result */
+    r::ResumableParser<Policy> parser(3);
+    parser.advance(view);
+    REQUIRE(!parser.complete());
+    REQUIRE(parser.replies_count() == 1);
+    auto positive_parse_result = parser.result(ok.data());
+    REQUIRE(positive_parse_result.consumed == 5);
+    auto &replies =
+        std::get<r::markers::array_holder_t>(positive_parse_result.result);
+    REQUIRE(replies.elements.size() == 1);
+    REQUIRE(std::visit(r::marker_helpers::equality("OK"),
+                       replies.elements[0]));
+
+    r::ResumableParser<TapePolicy> tape_parser(3);
+    tape_parser.advance(view);
+    auto tape_result = tape_parser.result(ok.data());
+    REQUIRE(tape_result.consumed == 5);
+    REQUIRE(tape_result.result.entries.size() == 1);
+    REQUIRE(tape_result.result.front().str() == "OK");
+};
+
+TEST_CASE("resumable parser: rebase onto incomplete reply", "[protocol]") {
+    using TapePolicy = r::parsing_policy::tape_result;
+    using DropPolicy = r::parsing_policy::drop_result;
+    std::string first = "+OK\r\n";
+    std::string head = "*2\r\n:1\r\n$5\r\nso";
+    std::string tail = "me!\r\n";
+
+    /* the parsed reply is consumed, the incomplete one is not examined
+     * again */
+    auto consume = [&](auto &parser, std::string &buffer) {
+        auto result = parser.result(buffer.data());
+        REQUIRE(result.consumed == first.size());
+        buffer.erase(0, first.size());
+        parser.rebase(2, true);
+        REQUIRE(parser.position() == head.size());
+        REQUIRE(parser.replies_count() == 0);
+        buffer += tail + first;
+        std::string_view view(buffer);
+        REQUIRE(parser.advance(view.substr(parser.position())) ==
+                tail.size() + first.size());
+        REQUIRE(parser.complete());
+        REQUIRE(parser.consumed() == buffer.size());
+        return result;
+    };
+
+    std::string buffer = first + head;
+    r::ResumableParser<Policy> parser(2);
+    parser.advance(buffer);
+    consume(parser, buffer);
+    auto result = parser.result(buffer.data());
+    auto &replies = std::get<r::markers::array_holder_t>(result.result);
+    REQUIRE(replies.elements.size() == 2);
+    auto &array = std::get<r::markers::array_holder_t>(replies.elements[0]);
+    REQUIRE(std::get<r::markers::int_t>(array.elements[0]) == "1");
+    REQUIRE(std::get<r::markers::string_t>(array.elements[1]) == "some!");
+    REQUIRE(std::get<r::markers::string_t>(replies.elements[1]) == "OK");
+
+    buffer = first + head;
+    r::ResumableParser<TapePolicy> tape_parser(2);
+    tape_parser.advance(buffer);
+    auto tape_result = consume(tape_parser, buffer);
+    REQUIRE(tape_result.result.entries.size() == 1);
+    auto tape = tape_parser.result(buffer.data()).result;
+    std::vector<r::markers::tape_cursor_t> tape_replies(tape.begin(),
+                                                        tape.end());
+    REQUIRE(tape_replies.size() == 2);
+    REQUIRE(tape_replies[0].size() == 2);
+    REQUIRE((++tape_replies[0].begin())->str() == "some!");
+    REQUIRE(tape_replies[1].str() == "OK");
+
+    /* the error of incomplete reply is the first one after rebase */
+    head = "!5\r\nER";
+    tail = "ROR\r\n";
+    buffer = first + head;
+    r::ResumableParser<DropPolicy> drop_parser(2);
+    drop_parser.advance(buffer);
+    consume(drop_parser, buffer);
+    auto dropped = drop_parser.result(buffer.data());
+    REQUIRE(dropped.replies == 2);
+    REQUIRE(dropped.errors == 1);
+    REQUIRE(dropped.first_error_index == 0);
+    REQUIRE(dropped.first_error == "ERROR");
+};
+
+TEST_CASE("resumable parser: reuse of result", "[protocol]") {
+    std::string ok = "*2\r\n*3\r\n:1\r\n:2\r\n:3\r\n+OK\r\n";
+    r::result_storage_t<Policy> storage;
+    const r::markers::redis_result_t *nested_data = nullptr;
+    for (int i = 0; i < 3; ++i) {
+        storage.parser.reset(1);
+        storage.parser.advance(ok);
+        REQUIRE(storage.parser.complete());
+        storage.parser.result(ok.data(), storage.result);
+        REQUIRE(storage.result.consumed == ok.size());
+
+        auto &array =
+            std::get<r::markers::array_holder_t>(storage.result.result);
+        REQUIRE(array.elements.size() == 2);
+        auto &nested =
+            std::get<r::markers::array_holder_t>(array.elements[0]);
+        REQUIRE(std::get<r::markers::int_t>(nested.elements[2]) == "3");
+        REQUIRE(std::get<r::markers::string_t>(array.elements[1]) == "OK");
+        /* the already allocated arrays are reused */
+        if (nested_data) {
+            REQUIRE(nested.elements.data() == nested_data);
+        }
+        nested_data = nested.elements.data();
+    }
+
+    using TapePolicy = r::parsing_policy::tape_result;
+    r::result_storage_t<TapePolicy> tape_storage;
+    std::size_t capacity = 0;
+    for (int i = 0; i < 3; ++i) {
+        tape_storage.parser.reset(1);
+        tape_storage.parser.advance(ok);
+        tape_storage.parser.result(ok.data(), tape_storage.result);
+        auto &tape = tape_storage.result.result;
+        REQUIRE(tape.entries.size() == 6);
+        REQUIRE(tape.front().size() == 2);
+        if (i > 1) {
+            REQUIRE(tape.entries.capacity() == capacity);
+        }
+        capacity = tape.entries.capacity();
+    }
+};
+
+TEST_CASE("scatter/gather parsing of buffer sequence", "[protocol]") {
+    using TapePolicy = r::parsing_policy::tape_result;
+    std::string ok = "*3\r\n$10\r\n0123456789\r\n:42\r\n*2\r\n+OK\r\n$-1\r\n"
+                     "-Err\r\n";
+    r::ResumableParser<TapePolicy> contiguous_parser(2);
+    contiguous_parser.advance(ok);
+    auto expected = contiguous_parser.result(ok.data());
+
+    auto check_tape = [&](const r::markers::tape_t &tape,
+                          const std::vector<asio::const_buffer> &buffers) {
+        REQUIRE(tape.entries.size() == expected.result.entries.size());
+        for (std::size_t i = 0; i < tape.entries.size(); ++i) {
+            auto &entry = tape.entries[i];
+            auto &expected_entry = expected.result.entries[i];
+            REQUIRE(entry.kind == expected_entry.kind);
+            REQUIRE(entry.offset == expected_entry.offset);
+            REQUIRE(entry.length == expected_entry.length);
+            REQUIRE(entry.children == expected_entry.children);
+        }
+        std::string content;
+        r::for_each_part(buffers, tape.entries[1],
+                         [&](std::string_view part) { content += part; });
+        REQUIRE(content == "0123456789");
+    };
+
+    /* the replies are split into two buffers at all positions */
+    for (std::size_t split = 1; split < ok.size(); ++split) {
+        std::vector<asio::const_buffer> buffers{
+            asio::buffer(ok.data(), split),
+            asio::buffer(ok.data() + split, ok.size() - split)};
+        r::ResumableParser<TapePolicy> parser(2);
+        REQUIRE(parser.advance_buffers(buffers) == ok.size());
+        REQUIRE(parser.complete());
+        REQUIRE(!parser.error());
+        auto result = parser.result(nullptr);
+        REQUIRE(result.consumed == ok.size());
+        check_tape(result.result, buffers);
+    }
+
+    /* single byte buffers, which arrive one by one */
+    std::vector<asio::const_buffer> buffers;
+    r::ResumableParser<TapePolicy> parser(2);
+    for (std::size_t i = 0; i < ok.size() && !parser.complete(); ++i) {
+        buffers.push_back(asio::buffer(ok.data() + i, 1));
+        parser.advance_buffers(buffers);
+    }
+    REQUIRE(parser.complete());
+    REQUIRE(!parser.error());
+    REQUIRE(parser.position() == ok.size());
+    check_tape(parser.result(nullptr).result, buffers);
+};
+
+TEST_CASE("tape: holding replies across reads", "[protocol]") {
+    using TapePolicy = r::parsing_policy::tape_result;
+    REQUIRE(sizeof(r::markers::tape_entry_t) == 16);
+
+    std::string buffer = "*2\r\n$3\r\nfoo\r\n:7\r\n";
+    r::ResumableParser<TapePolicy> parser;
+    parser.advance(buffer);
+    auto first = parser.result(buffer.data());
+    REQUIRE(first.consumed == buffer.size());
+
+    /* the next reply is parsed after the held one, then the buffer
+     * grows and is relocated */
+    std::string next = "$3\r\nbar\r\n";
+    buffer += next;
+    parser.reset(1, first.consumed);
+    REQUIRE(parser.advance(std::string_view(buffer).substr(
+                parser.position())) == next.size());
+    auto second = parser.result(buffer.data());
+    REQUIRE(second.consumed == next.size());
+    std::string relocated = buffer;
+    buffer.assign(buffer.size(), 'x');
+
+    first.result.rebind(relocated.data());
+    second.result.rebind(relocated.data());
+    REQUIRE(first.result.front().begin()->str() == "foo");
+    REQUIRE(second.result.front().str() == "bar");
+
+    /* the held reply is consumed, i.e. the buffer is compacted */
+    std::string compacted = relocated.substr(first.consumed);
+    second.result.rebind(compacted.data(), first.consumed);
+    REQUIRE(second.result.front().str() == "bar");
+};
+
+TEST_CASE("tape: offset range", "[protocol]") {
+    using TapePolicy = r::parsing_policy::tape_result;
+    std::size_t max_offset = std::numeric_limits<std::uint32_t>::max();
+    std::string reply = ":1\r\n";
+
+    r::ResumableParser<TapePolicy> parser(1, max_offset - reply.size());
+    parser.advance(reply);
+    REQUIRE(parser.complete());
+    REQUIRE(!parser.error());
+
+    parser.reset(1, max_offset - reply.size() + 1);
+    parser.advance(reply);
+    REQUIRE(parser.error().message() ==
+            "Reply exceeds offset range of markers");
+
+    parser.reset(1, max_offset - 10);
+    parser.advance("$10\r\n");
+    REQUIRE(parser.error().message() ==
+            "Reply exceeds offset range of markers");
+
+    r::ResumableParser<r::parsing_policy::drop_result> drop_parser(
+        1, max_offset);
+    drop_parser.advance(reply);
+    REQUIRE(drop_parser.complete());
+    REQUIRE(!drop_parser.error());
+
+    /* the markers are not limited by the tape offsets */
+    r::ResumableParser<Policy> keep_parser(1, max_offset);
+    keep_parser.advance(reply);
+    REQUIRE(keep_parser.complete());
+    REQUIRE(!keep_parser.error());
+    keep_parser.reset(1, max_offset - 10);
+    keep_parser.advance("$10\r\n");
+    REQUIRE(!keep_parser.complete());
+    REQUIRE(!keep_parser.error());
+};
+
+TEST_CASE("RESP3 scalars", "[protocol]") {
+    std::string ok = ",3.14\r\n#t\r\n#f\r\n(3492890328409238509324850943850943825024"
+                     "385\r\n_\r\n=15\r\ntxt:Some string\r\n!21\r\nSYNTAX invalid"
+                     " syntax\r\n";
+    r::ResumableParser<Policy> parser(7);
+    parser.advance(ok);
+    REQUIRE(parser.complete());
+    REQUIRE(!parser.error());
+    REQUIRE(parser.consumed() == ok.size());
+
+    auto result = parser.result(ok.data());
+    auto &replies = std::get<r::markers::array_holder_t>(result.result);
+    REQUIRE(replies.elements.size() == 7);
+
+    auto &value = std::get<r::markers::double_t>(replies.elements[0]);
+    REQUIRE(value == "3.14");
+    REQUIRE(std::get<r::markers::bool_t>(replies.elements[1]).value());
+    REQUIRE(!std::get<r::markers::bool_t>(replies.elements[2]).value());
+    auto &number = std::get<r::markers::big_number_t>(replies.elements[3]);
+    REQUIRE(number == "3492890328409238509324850943850943825024385");
+    REQUIRE(std::holds_alternative<r::markers::nil_t>(replies.elements[4]));
+    auto &verbatim = std::get<r::markers::verbatim_t>(replies.elements[5]);
+    REQUIRE(verbatim.format() == "txt");
+    REQUIRE(verbatim.text() == "Some string");
+    auto &error = std::get<r::markers::error_t>(replies.elements[6]);
+    REQUIRE(error == "SYNTAX invalid syntax");
+
+    /* the same via Protocol::parse */
+    auto parsed_result = r::Protocol::parse(std::string_view(ok).substr(7));
+    auto &positive = std::get<positive_result_t>(parsed_result);
+    REQUIRE(positive.consumed == 4);
+    REQUIRE(std::get<r::markers::bool_t>(positive.result).value());
+};
+
+TEST_CASE("RESP3 aggregates", "[protocol]") {
+    using TapePolicy = r::parsing_policy::tape_result;
+    std::string ok = "%2\r\n+first\r\n:1\r\n+second\r\n~2\r\n+a\r\n+b\r\n"
+                     ">3\r\n$7\r\nmessage\r\n$2\r\nch\r\n$5\r\nhello\r\n"
+                     "%0\r\n";
+
+    auto parsed_result = r::Protocol::parse(ok);
+    auto &positive = std::get<positive_result_t>(parsed_result);
+    REQUIRE(positive.consumed == ok.find(">3"));
+    auto &map = std::get<r::markers::map_holder_t>(positive.result);
+    REQUIRE(map.elements.size() == 4);
+    REQUIRE(std::get<r::markers::string_t>(map.elements[2]) == "second");
+    auto &set = std::get<r::markers::set_holder_t>(map.elements[3]);
+    REQUIRE(set.elements.size() == 2);
+
+    /* markers are built from the tape in the chunk by chunk parsing */
+    r::ResumableParser<Policy> parser(3);
+    for (std::size_t i = 1; i <= ok.size() && !parser.complete(); ++i) {
+        auto position = parser.position();
+        parser.advance(std::string_view(ok).substr(position, i - position));
+    }
+    REQUIRE(parser.complete());
+    REQUIRE(!parser.error());
+    auto result = parser.result(ok.data());
+    auto &replies = std::get<r::markers::array_holder_t>(result.result);
+    auto &push = std::get<r::markers::push_holder_t>(replies.elements[1]);
+    REQUIRE(push.elements.size() == 3);
+    REQUIRE(std::get<r::markers::string_t>(push.elements[2]) == "hello");
+    auto &empty = std::get<r::markers::map_holder_t>(replies.elements[2]);
+    REQUIRE(empty.elements.empty());
+    REQUIRE(std::visit(r::marker_helpers::stringizer(), replies.elements[1]) ==
+            "[push] {[str] message, [str] ch, [str] hello, }");
+
+    r::ResumableParser<TapePolicy> tape_parser(3);
+    tape_parser.advance(ok);
+    auto tape = tape_parser.result(ok.data()).result;
+    REQUIRE(tape.entries.size() == 12);
+    auto it = tape.begin();
+    REQUIRE(it->kind() == r::markers::tape_kind_t::map);
+    REQUIRE(it->size() == 4);
+    REQUIRE((++it)->kind() == r::markers::tape_kind_t::push);
+    REQUIRE(it->is_aggregate());
+    REQUIRE(r::markers::visit(r::marker_helpers::stringizer(), *it) ==
+            "[push] {[str] message, [str] ch, [str] hello, }");
+    REQUIRE((++it)->kind() == r::markers::tape_kind_t::map);
+    REQUIRE(++it == tape.end());
+};
+
+TEST_CASE("RESP3 attributes", "[protocol]") {
+    std::string ok = "|1\r\n+key-popularity\r\n%2\r\n$1\r\na\r\n,0.19\r\n"
+                     "$1\r\nb\r\n,0.05\r\n*2\r\n:2039123\r\n|1\r\n+ttl\r\n"
+                     "*1\r\n:3600\r\n:9543892\r\n";
+    r::ResumableParser<Policy> parser;
+    for (std::size_t i = 1; i <= ok.size() && !parser.complete(); ++i) {
+        auto position = parser.position();
+        parser.advance(std::string_view(ok).substr(position, i - position));
+    }
+    REQUIRE(parser.complete());
+    REQUIRE(!parser.error());
+    REQUIRE(parser.consumed() == ok.size());
+
+    /* the attributes are not the part of result */
+    auto result = parser.result(ok.data());
+    auto &array = std::get<r::markers::array_holder_t>(result.result);
+    REQUIRE(array.elements.size() == 2);
+    REQUIRE(std::get<r::markers::int_t>(array.elements[0]) == "2039123");
+    REQUIRE(std::get<r::markers::int_t>(array.elements[1]) == "9543892");
+
+    auto parsed_result = r::Protocol::parse(ok);
+    auto &positive = std::get<positive_result_t>(parsed_result);
+    REQUIRE(positive.consumed == ok.size());
+    REQUIRE(std::visit(r::marker_helpers::stringizer(), positive.result) ==
+            "[array] {[int] 2039123, [int] 9543892, }");
+};
+
+TEST_CASE("RESP3 protocol errors", "[protocol]") {
+    r::ResumableParser<r::parsing_policy::drop_result> parser;
+    parser.advance("%-1\r\n");
+    REQUIRE(parser.error().message() == "Unacceptable count value");
+
+    parser.reset(1);
+    parser.advance("=-1\r\n");
+    REQUIRE(parser.error().message() == "Unacceptable count value");
+
+    parser.reset(1);
+    parser.advance("%2147483648\r\n");
+    REQUIRE(parser.error().message() == "Unacceptable count value");
+
+    parser.reset(1);
+    parser.advance("!4\r\nsomemm");
+    REQUIRE(parser.error().message() == "Terminator for bulk string not found");
+
+    std::string nested;
+    for (int i = 0; i <= BREDIS_MAX_NESTING_DEPTH; ++i) {
+        nested += "|1\r\n";
+    }
+    parser.reset(1);
+    parser.advance(nested);
+    REQUIRE(parser.error().message() == "Nesting depth limit exceeded");
+};
+
+TEST_CASE("streaming of bulk string", "[protocol]") {
+    std::string ok = "$10\r\n0123456789\r\n+OK\r\n";
+    std::string streamed;
+    auto on_chunk = [&](std::string_view chunk, std::size_t left) {
+        REQUIRE(!chunk.empty());
+        streamed += chunk;
+        REQUIRE(streamed.size() + left == 10);
+    };
+
+    /* the data arrives byte by byte and is consumed right away */
+    r::bulk_stream_t stream;
+    std::string buffer;
+    std::size_t i = 0;
+    for (; i < ok.size() && !stream.complete(); ++i) {
+        buffer += ok[i];
+        buffer.erase(0, stream.advance(asio::buffer(buffer), on_chunk));
+    }
+    REQUIRE(stream.streamed());
+    REQUIRE(!stream.error());
+    REQUIRE(stream.size() == 10);
+    REQUIRE(streamed == "0123456789");
+    REQUIRE(buffer.empty());
+    REQUIRE(ok.substr(i) == "+OK\r\n");
+
+    /* non-contiguous buffers */
+    streamed.clear();
+    stream.reset();
+    std::vector<asio::const_buffer> buffers{asio::buffer(ok.data(), 7),
+                                            asio::buffer(ok.data() + 7, 8),
+                                            asio::buffer(ok.data() + 15, 2)};
+    REQUIRE(stream.advance(buffers, on_chunk) == 17);
+    REQUIRE(stream.streamed());
+    REQUIRE(streamed == "0123456789");
+
+    /* other replies are left for the parser */
+    std::string not_bulk[] = {"+OK\r\n", "$-1\r\n", "*1\r\n$1\r\na\r\n", "$"
+                              "12345678901234567890123\r\n"};
+    for (auto &reply : not_bulk) {
+        stream.reset();
+        REQUIRE(stream.advance(asio::buffer(reply), on_chunk) == 0);
+        REQUIRE(stream.complete());
+        REQUIRE(stream.not_streamed());
+    }
+
+    stream.reset();
+    std::string wrong = "$4\r\nsomemm";
+    stream.advance(asio::buffer(wrong), [](std::string_view, std::size_t) {});
+    REQUIRE(stream.complete());
+    REQUIRE(stream.error().message() == "Terminator for bulk string not found");
+};
+
+TEST_CASE("streaming of aggregate elements", "[protocol]") {
+    using stringizer_t = r::marker_helpers::stringizer;
+    std::string ok = "*3\r\n$1\r\na\r\n*2\r\n:1\r\n:2\r\n*0\r\n+OK\r\n";
+    std::vector<std::string> elements;
+    auto on_element = [&](const r::markers::redis_result_t &element) {
+        elements.push_back(std::visit(stringizer_t(), element));
+    };
+
+    /* the data arrives byte by byte and is consumed right away */
+    r::aggregate_stream_t stream;
+    std::string buffer;
+    std::size_t i = 0;
+    for (; i < ok.size() && !stream.complete(); ++i) {
+        buffer += ok[i];
+        buffer.erase(0, stream.advance(asio::buffer(buffer), on_element));
+    }
+    REQUIRE(stream.streamed());
+    REQUIRE(!stream.error());
+    REQUIRE(stream.count() == 3);
+    REQUIRE(buffer.empty());
+    REQUIRE(ok.substr(i) == "+OK\r\n");
+    std::vector<std::string> expected{
+        "[str] a", "[array] {[int] 1, [int] 2, }", "[array] {}"};
+    REQUIRE(elements == expected);
+    REQUIRE(std::holds_alternative<r::markers::array_holder_t>(
+        stream.streamed_marker()));
+
+    /* the elements of nested aggregates */
+    elements.clear();
+    stream.reset(2);
+    REQUIRE(stream.advance(asio::buffer(ok), on_element) == ok.size() - 5);
+    REQUIRE(stream.streamed());
+    expected = {"[str] a", "[int] 1", "[int] 2", "[array] {}"};
+    REQUIRE(elements == expected);
+
+    /* map */
+    std::string map = "%2\r\n+a\r\n:1\r\n+b\r\n:2\r\n";
+    elements.clear();
+    stream.reset();
+    REQUIRE(stream.advance(asio::buffer(map), on_element) == map.size());
+    REQUIRE(elements.size() == 4);
+    REQUIRE(std::holds_alternative<r::markers::map_holder_t>(
+        stream.streamed_marker()));
+
+    /* other replies are left for the parser */
+    std::string not_aggregate[] = {"+OK\r\n", "*-1\r\n", "$1\r\na\r\n"};
+    for (auto &reply : not_aggregate) {
+        stream.reset();
+        REQUIRE(stream.advance(asio::buffer(reply), on_element) == 0);
+        REQUIRE(stream.complete());
+        REQUIRE(stream.not_streamed());
+    }
+
+    stream.reset();
+    std::string wrong = "*2\r\n:1\r\n!OK\r\n";
+    REQUIRE(stream.advance(asio::buffer(wrong), on_element) == 8);
+    REQUIRE(stream.complete());
+    REQUIRE(stream.error().message() == "Cannot convert count to number");
+};
@@ -1,7 +1,10 @@
 #include <boost/asio.hpp>
+#include <cmath>
+#include <limits>
 #include <string>
 
 #include "bredis/Extract.hpp"
+#include "bredis/Protocol.hpp"
 
 #include "catch.hpp"
 
@@ -125,3 +128,70 @@ TEST_CASE("vector extraction", "[protocol]") {
     REQUIRE(t1->str == "src");
     REQUIRE(*t2 == 5);
 }
+
+TEST_CASE("tape extraction", "[protocol]") {
+    std::string source = "*2\r\n$3\r\nsrc\r\n*1\r\n:5\r\n";
+    auto parsed_result =
+        r::Protocol::parse<r::parsing_policy::tape_result>(source);
+    auto &tape = std::get<1>(parsed_result).result;
+
+    auto r = r::markers::visit(r::extractor(), tape.front());
+    auto *target = std::get_if<r::extracts::array_holder_t>(&r);
+    REQUIRE(target);
+    REQUIRE(target->elements.size() == 2);
+    auto *t1 = std::get_if<r::extracts::string_t>(&target->elements[0]);
+    auto *t2 = std::get_if<r::extracts::array_holder_t>(&target->elements[1]);
+    REQUIRE(t1);
+    REQUIRE(t2);
+    REQUIRE(t1->str == "src");
+    REQUIRE(std::get<r::extracts::int_t>(t2->elements[0]) == 5);
+}
+
+TEST_CASE("RESP3 doubles extraction", "[protocol]") {
+    auto extract = [](const std::string &source) {
+        auto parsed_result = r::Protocol::parse(source);
+        auto &positive = std::get<1>(parsed_result);
+        return std::get<r::extracts::double_t>(
+            std::visit(r::extractor(), positive.result));
+    };
+    REQUIRE(extract(",1.5\r\n") == 1.5);
+    REQUIRE(extract(",-2\r\n") == -2);
+    REQUIRE(extract(",+2.5e3\r\n") == 2500);
+    REQUIRE(extract(",1.5E-2\r\n") == 0.015);
+    REQUIRE(extract(",inf\r\n") == std::numeric_limits<double>::infinity());
+    REQUIRE(extract(",-inf\r\n") ==
+            -std::numeric_limits<double>::infinity());
+    REQUIRE(std::isnan(extract(",nan\r\n")));
+    REQUIRE_THROWS_AS(extract(",1.5x\r\n"), const boost::bad_lexical_cast &);
+}
+
+TEST_CASE("RESP3 extraction", "[protocol]") {
+    std::string source = "%3\r\n+pi\r\n,3.14\r\n+flag\r\n#t\r\n+note\r\n"
+                         "=8\r\ntxt:text\r\n~1\r\n(12345678901234567890\r\n";
+    auto check = [](const r::extracts::extraction_result_t &r) {
+        auto *map = std::get_if<r::extracts::map_holder_t>(&r);
+        REQUIRE(map);
+        REQUIRE(map->elements.size() == 6);
+        REQUIRE(std::get<r::extracts::double_t>(map->elements[1]) == 3.14);
+        REQUIRE(std::get<r::extracts::bool_t>(map->elements[3]));
+        auto &verbatim = std::get<r::extracts::verbatim_t>(map->elements[5]);
+        REQUIRE(verbatim.format == "txt");
+        REQUIRE(verbatim.str == "text");
+    };
+
+    auto parsed_result = r::Protocol::parse(source);
+    auto &positive = std::get<1>(parsed_result);
+    check(std::visit(r::extractor(), positive.result));
+
+    auto tape_result =
+        r::Protocol::parse<r::parsing_policy::tape_result>(source);
+    auto &tape = std::get<1>(tape_result).result;
+    check(r::markers::visit(r::extractor(), tape.front()));
+
+    auto set_result = r::Protocol::parse(
+        std::string_view(source).substr(positive.consumed));
+    auto r = std::visit(r::extractor(), std::get<1>(set_result).result);
+    auto &set = std::get<r::extracts::set_holder_t>(r);
+    REQUIRE(std::get<r::extracts::big_number_t>(set.elements[0]).str ==
+            "12345678901234567890");
+}
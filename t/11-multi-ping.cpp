@@ -1,4 +1,5 @@
 #include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
 #include <future>
 #include <vector>
 
@@ -56,4 +56,20 @@ TEST_CASE("ping", "[connection]") {
     REQUIRE(!ec);
     REQUIRE(std::visit(equality, parse_result.result));
     rx_buff.consume(parse_result.consumed);
+
+    /* reusable result storage */
+    r::result_storage_t<> storage;
+    for (int i = 0; i < 3; ++i) {
+        c.write("ping");
+        auto &stored_result = c.read(rx_buff, storage);
+        REQUIRE(&stored_result == &storage.result);
+        REQUIRE(std::visit(equality, stored_result.result));
+        rx_buff.consume(stored_result.consumed);
+    }
+
+    c.write("ping");
+    auto &stored_result = c.read(rx_buff, storage, ec);
+    REQUIRE(!ec);
+    REQUIRE(std::visit(equality, stored_result.result));
+    rx_buff.consume(stored_result.consumed);
 };
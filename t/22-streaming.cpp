@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <future>
+
+#include "EmptyPort.hpp"
+#include "TestServer.hpp"
+#include "catch.hpp"
+
+#include "bredis/Connection.hpp"
+#include "bredis/MarkerHelpers.hpp"
+
+#include "SocketWithLogging.hpp"
+
+namespace r = bredis;
+namespace asio = boost::asio;
+namespace ep = empty_port;
+namespace ts = test_server;
+
+TEST_CASE("streaming of bulk string", "[connection]") {
+    using socket_t = asio::ip::tcp::socket;
+#ifdef BREDIS_DEBUG
+    using next_layer_t = r::test::SocketWithLogging<socket_t>;
+#else
+    using next_layer_t = socket_t;
+#endif
+    using Buffer = boost::asio::streambuf;
+    using Policy = r::parsing_policy::keep_result;
+    using result_t = r::positive_parse_result_t<Policy>;
+
+    std::chrono::milliseconds sleep_delay(1);
+
+    uint16_t port = ep::get_random<ep::Kind::TCP>();
+    auto port_str = boost::lexical_cast<std::string>(port);
+    auto server = ts::make_server({"redis-server", "--port", port_str});
+    ep::wait_port<ep::Kind::TCP>(port);
+    asio::io_service io_service;
+
+    asio::ip::tcp::endpoint end_point(
+        asio::ip::address::from_string("127.0.0.1"), port);
+    socket_t socket(io_service, end_point.protocol());
+    socket.connect(end_point);
+
+    r::Connection<next_layer_t> c(std::move(socket));
+    Buffer tx_buff, rx_buff;
+
+    std::string value(1024 * 1024 + 7, ' ');
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        value[i] = static_cast<char>('a' + i % 26);
+    }
+    c.write(r::single_command_t{"set", "big", value});
+    auto parse_result = c.read(rx_buff);
+    rx_buff.consume(parse_result.consumed);
+
+    std::string streamed;
+    std::size_t max_buffered = 0;
+    auto on_chunk = [&](std::string_view chunk, std::size_t left) {
+        streamed += chunk;
+        REQUIRE(streamed.size() + left == value.size());
+        max_buffered = std::max(max_buffered, rx_buff.size());
+    };
+
+    /* sync */
+    c.write(r::single_command_t{"get", "big"});
+    parse_result = c.read_stream(rx_buff, on_chunk);
+    REQUIRE(streamed == value);
+    REQUIRE(std::get<r::markers::string_t>(parse_result.result).empty());
+    REQUIRE(parse_result.consumed == 0);
+    REQUIRE(max_buffered <= 65536);
+
+    /* other replies are not streamed */
+    c.write(r::single_command_t{"get", "missing"});
+    parse_result = c.read_stream(rx_buff, on_chunk);
+    REQUIRE(std::holds_alternative<r::markers::nil_t>(parse_result.result));
+    rx_buff.consume(parse_result.consumed);
+
+    /* async */
+    streamed.clear();
+    r::command_container_t cmds{r::single_command_t{"get", "big"},
+                                r::single_command_t{"ping"}};
+    std::promise<result_t> completion_promise;
+    std::future<result_t> completion_future = completion_promise.get_future();
+    c.async_write(
+        tx_buff, cmds, [&](const auto &error_code, auto bytes_transferred) {
+            REQUIRE(!error_code);
+            tx_buff.consume(bytes_transferred);
+        });
+    c.async_read_stream(
+        rx_buff, on_chunk, [&](const auto &error_code, auto &&r) {
+            REQUIRE(!error_code);
+            REQUIRE(streamed == value);
+            c.async_read_stream(
+                rx_buff, on_chunk, [&](const auto &error_code, auto &&r) {
+                    REQUIRE(!error_code);
+                    completion_promise.set_value(r);
+                });
+        });
+
+    while (completion_future.wait_for(sleep_delay) !=
+           std::future_status::ready) {
+        io_service.run_one();
+    }
+    auto ping_result = completion_future.get();
+    REQUIRE(std::visit(r::marker_helpers::equality("PONG"),
+                       ping_result.result));
+    rx_buff.consume(ping_result.consumed);
+
+    /* zero-copy write of the value */
+    io_service.reset();
+    std::reverse(value.begin(), value.end());
+    std::promise<std::size_t> write_promise;
+    std::future<std::size_t> write_future = write_promise.get_future();
+    r::single_command_t set_cmd{"set", "big", value};
+    c.async_write(set_cmd, [&](const auto &error_code, auto bytes_transferred) {
+        REQUIRE(!error_code);
+        write_promise.set_value(bytes_transferred);
+    });
+    while (write_future.wait_for(sleep_delay) != std::future_status::ready) {
+        io_service.run_one();
+    }
+    REQUIRE(write_future.get() > value.size());
+    parse_result = c.read(rx_buff);
+    rx_buff.consume(parse_result.consumed);
+    streamed.clear();
+    c.write(r::single_command_t{"get", "big"});
+    c.read_stream(rx_buff, on_chunk);
+    REQUIRE(streamed == value);
+};
+
+TEST_CASE("streaming of array elements", "[connection]") {
+    using socket_t = asio::ip::tcp::socket;
+#ifdef BREDIS_DEBUG
+    using next_layer_t = r::test::SocketWithLogging<socket_t>;
+#else
+    using next_layer_t = socket_t;
+#endif
+    using Buffer = boost::asio::streambuf;
+    using Policy = r::parsing_policy::keep_result;
+    using result_t = r::positive_parse_result_t<Policy>;
+
+    std::chrono::milliseconds sleep_delay(1);
+
+    uint16_t port = ep::get_random<ep::Kind::TCP>();
+    auto port_str = boost::lexical_cast<std::string>(port);
+    auto server = ts::make_server({"redis-server", "--port", port_str});
+    ep::wait_port<ep::Kind::TCP>(port);
+    asio::io_service io_service;
+
+    asio::ip::tcp::endpoint end_point(
+        asio::ip::address::from_string("127.0.0.1"), port);
+    socket_t socket(io_service, end_point.protocol());
+    socket.connect(end_point);
+
+    r::Connection<next_layer_t> c(std::move(socket));
+    Buffer tx_buff, rx_buff;
+
+    std::size_t count = 50000;
+    std::vector<std::string> items;
+    r::single_command_t rpush{"rpush", "list"};
+    for (std::size_t i = 0; i < count; ++i) {
+        items.push_back("item-" + std::to_string(i));
+    }
+    for (const auto &item : items) {
+        rpush.arguments.emplace_back(item);
+    }
+    c.write(rpush);
+    auto parse_result = c.read(rx_buff);
+    rx_buff.consume(parse_result.consumed);
+
+    std::size_t index = 0;
+    std::size_t max_buffered = 0;
+    auto on_element = [&](const r::markers::redis_result_t &element) {
+        REQUIRE(std::visit(r::marker_helpers::equality(items[index++]),
+                           element));
+        max_buffered = std::max(max_buffered, rx_buff.size());
+    };
+
+    /* sync */
+    c.write(r::single_command_t{"lrange", "list", "0", "-1"});
+    parse_result = c.read_elements(rx_buff, on_element);
+    REQUIRE(index == count);
+    auto &array = std::get<r::markers::array_holder_t>(parse_result.result);
+    REQUIRE(array.elements.empty());
+    REQUIRE(parse_result.consumed == 0);
+    REQUIRE(max_buffered < 65536 + 64);
+
+    /* other replies are not streamed */
+    c.write(r::single_command_t{"ping"});
+    parse_result = c.read_elements(rx_buff, on_element);
+    REQUIRE(std::visit(r::marker_helpers::equality("PONG"),
+                       parse_result.result));
+    rx_buff.consume(parse_result.consumed);
+
+    /* async */
+    index = 0;
+    std::promise<result_t> completion_promise;
+    std::future<result_t> completion_future = completion_promise.get_future();
+    c.async_write(tx_buff,
+                  r::single_command_t{"lrange", "list", "0", "-1"},
+                  [&](const auto &error_code, auto bytes_transferred) {
+                      REQUIRE(!error_code);
+                      tx_buff.consume(bytes_transferred);
+                  });
+    c.async_read_elements(rx_buff, on_element,
+                          [&](const auto &error_code, auto &&r) {
+                              REQUIRE(!error_code);
+                              completion_promise.set_value(r);
+                          });
+
+    while (completion_future.wait_for(sleep_delay) !=
+           std::future_status::ready) {
+        io_service.run_one();
+    }
+    completion_future.get();
+    REQUIRE(index == count);
+};
@@ -0,0 +1,185 @@
+#include <boost/asio.hpp>
+#include <future>
+#include <vector>
+
+#include "EmptyPort.hpp"
+#include "TestServer.hpp"
+#include "catch.hpp"
+
+#include "bredis/Connection.hpp"
+#include "bredis/MarkerHelpers.hpp"
+
+#include "SocketWithLogging.hpp"
+
+namespace r = bredis;
+namespace asio = boost::asio;
+namespace ep = empty_port;
+namespace ts = test_server;
+
+TEST_CASE("dispatching of pipelined replies", "[connection]") {
+    using socket_t = asio::ip::tcp::socket;
+#ifdef BREDIS_DEBUG
+    using next_layer_t = r::test::SocketWithLogging<socket_t>;
+#else
+    using next_layer_t = socket_t;
+#endif
+    using Buffer = boost::asio::streambuf;
+    using Policy = r::parsing_policy::keep_result;
+    using result_t = r::positive_parse_result_t<Policy>;
+
+    std::chrono::milliseconds sleep_delay(1);
+
+    uint16_t port = ep::get_random<ep::Kind::TCP>();
+    auto port_str = boost::lexical_cast<std::string>(port);
+    auto server = ts::make_server({"redis-server", "--port", port_str});
+    ep::wait_port<ep::Kind::TCP>(port);
+    asio::io_service io_service;
+
+    asio::ip::tcp::endpoint end_point(
+        asio::ip::address::from_string("127.0.0.1"), port);
+    socket_t socket(io_service, end_point.protocol());
+    socket.connect(end_point);
+
+    r::Connection<next_layer_t> c(std::move(socket));
+    Buffer tx_buff, rx_buff;
+
+    std::size_t count = 20000;
+    r::single_command_t cmd_incr{"INCR", "dispatch:count"};
+    r::command_container_t cmds;
+    for (std::size_t i = 0; i < count; ++i) {
+        cmds.push_back(cmd_incr);
+    }
+    c.write(r::single_command_t{"del", "dispatch:count"});
+    rx_buff.consume(c.read(rx_buff).consumed);
+
+    /* each reply is delivered on its own, in the order of commands */
+    std::size_t expected = 1;
+    std::size_t max_buffered = 0;
+    auto on_reply = [&](const result_t &reply) {
+        REQUIRE(std::visit(r::marker_helpers::equality(
+                               std::to_string(expected)),
+                           reply.result));
+        ++expected;
+        max_buffered = std::max(max_buffered, rx_buff.size());
+    };
+
+    std::promise<std::size_t> completion_promise;
+    auto completion_future = completion_promise.get_future();
+    c.async_write(
+        tx_buff, cmds, [&](const auto &error_code, auto bytes_transferred) {
+            REQUIRE(!error_code);
+            tx_buff.consume(bytes_transferred);
+        });
+    c.async_dispatch(rx_buff, on_reply,
+                     [&](const auto &error_code, std::size_t delivered) {
+                         REQUIRE(!error_code);
+                         completion_promise.set_value(delivered);
+                     },
+                     count);
+    while (completion_future.wait_for(sleep_delay) !=
+           std::future_status::ready) {
+        io_service.run_one();
+    }
+    REQUIRE(completion_future.get() == count);
+    REQUIRE(expected == count + 1);
+    REQUIRE(rx_buff.size() == 0);
+    REQUIRE(max_buffered <= 65536);
+
+    /* batches of the already received replies */
+    io_service.reset();
+    std::size_t max_batch = 64;
+    std::size_t batches = 0;
+    auto on_batch = [&](const result_t &batch) {
+        auto &replies = std::get<r::markers::array_holder_t>(batch.result);
+        REQUIRE(!replies.elements.empty());
+        REQUIRE(replies.elements.size() <= max_batch);
+        for (const auto &reply : replies.elements) {
+            REQUIRE(std::visit(r::marker_helpers::equality(
+                                   std::to_string(expected)),
+                               reply));
+            ++expected;
+        }
+        ++batches;
+    };
+
+    std::promise<std::size_t> batch_promise;
+    auto batch_future = batch_promise.get_future();
+    c.async_write(
+        tx_buff, cmds, [&](const auto &error_code, auto bytes_transferred) {
+            REQUIRE(!error_code);
+            tx_buff.consume(bytes_transferred);
+        });
+    c.async_dispatch(rx_buff, on_batch,
+                     [&](const auto &error_code, std::size_t delivered) {
+                         REQUIRE(!error_code);
+                         batch_promise.set_value(delivered);
+                     },
+                     count, max_batch);
+    while (batch_future.wait_for(sleep_delay) != std::future_status::ready) {
+        io_service.run_one();
+    }
+    REQUIRE(batch_future.get() == count);
+    REQUIRE(expected == 2 * count + 1);
+    REQUIRE(batches >= count / max_batch);
+
+    /* the last batch of single reply is wrapped too */
+    io_service.reset();
+    std::size_t tail_count = 5;
+    std::size_t tail_batch = 4;
+    r::command_container_t tail_cmds(tail_count, cmd_incr);
+    std::vector<std::size_t> batch_sizes;
+    std::promise<std::size_t> tail_promise;
+    auto tail_future = tail_promise.get_future();
+    c.write(tail_cmds);
+    // all the replies are received upfront, i.e. the batches are 4 and 1
+    std::size_t tail_bytes = 0;
+    for (std::size_t i = 0; i < tail_count; ++i) {
+        tail_bytes += std::to_string(expected + i).size() + 3;
+    }
+    asio::read(c.next_layer(), rx_buff, asio::transfer_exactly(tail_bytes));
+    c.async_dispatch(
+        rx_buff,
+        [&](const result_t &batch) {
+            auto &replies = std::get<r::markers::array_holder_t>(batch.result);
+            for (const auto &reply : replies.elements) {
+                REQUIRE(std::visit(r::marker_helpers::equality(
+                                       std::to_string(expected)),
+                                   reply));
+                ++expected;
+            }
+            batch_sizes.push_back(replies.elements.size());
+        },
+        [&](const auto &error_code, std::size_t delivered) {
+            REQUIRE(!error_code);
+            tail_promise.set_value(delivered);
+        },
+        tail_count, tail_batch);
+    while (tail_future.wait_for(sleep_delay) != std::future_status::ready) {
+        io_service.run_one();
+    }
+    REQUIRE(tail_future.get() == tail_count);
+    REQUIRE((batch_sizes == std::vector<std::size_t>{4, 1}));
+
+    /* unlimited dispatching lasts until error */
+    io_service.reset();
+    std::promise<boost::system::error_code> error_promise;
+    auto error_future = error_promise.get_future();
+    std::size_t replies = 0;
+    c.async_dispatch(rx_buff,
+                     [&](const result_t &reply) {
+                         if (++replies == 3) {
+                             c.next_layer().close();
+                         }
+                     },
+                     [&](const auto &error_code, std::size_t delivered) {
+                         REQUIRE(delivered == 3);
+                         error_promise.set_value(error_code);
+                     });
+    c.write(r::command_container_t{r::single_command_t{"ping"},
+                                   r::single_command_t{"ping"},
+                                   r::single_command_t{"ping"}});
+    while (error_future.wait_for(sleep_delay) != std::future_status::ready) {
+        io_service.run_one();
+    }
+    REQUIRE(error_future.get());
+};
@@ -0,0 +1,264 @@
+#include <boost/asio.hpp>
+#include <future>
+
+#include "EmptyPort.hpp"
+#include "TestServer.hpp"
+#include "catch.hpp"
+
+#include "bredis/MarkerHelpers.hpp"
+#include "bredis/Multiplexer.hpp"
+
+#include "SocketWithLogging.hpp"
+
+namespace r = bredis;
+namespace asio = boost::asio;
+namespace ep = empty_port;
+namespace ts = test_server;
+
+TEST_CASE("multiplexing of commands", "[connection]") {
+    using socket_t = asio::ip::tcp::socket;
+#ifdef BREDIS_DEBUG
+    using next_layer_t = r::test::SocketWithLogging<socket_t>;
+#else
+    using next_layer_t = socket_t;
+#endif
+
+    std::chrono::milliseconds sleep_delay(1);
+
+    uint16_t port = ep::get_random<ep::Kind::TCP>();
+    auto port_str = boost::lexical_cast<std::string>(port);
+    auto server = ts::make_server({"redis-server", "--port", port_str});
+    ep::wait_port<ep::Kind::TCP>(port);
+    asio::io_service io_service;
+
+    asio::ip::tcp::endpoint end_point(
+        asio::ip::address::from_string("127.0.0.1"), port);
+    socket_t socket(io_service, end_point.protocol());
+    socket.connect(end_point);
+
+    r::Multiplexer<next_layer_t> m(std::move(socket));
+    std::size_t count = 1000;
+    std::size_t completed = 0;
+    std::promise<void> completion_promise;
+    auto completion_future = completion_promise.get_future();
+    auto done = [&]() {
+        if (++completed == count + 4) {
+            completion_promise.set_value();
+        }
+    };
+
+    m.async_command({"del", "mx:count"},
+                    [&](const auto &ec, const auto &reply) {
+                        REQUIRE(!ec);
+                        REQUIRE(
+                            std::holds_alternative<r::markers::int_t>(reply));
+                    });
+    /* the replies are routed in the order of commands */
+    for (std::size_t i = 1; i <= count; ++i) {
+        m.async_command({"incr", "mx:count"},
+                        [&, i](const auto &ec, const auto &reply) {
+                            REQUIRE(!ec);
+                            REQUIRE(std::visit(r::marker_helpers::equality(
+                                                   std::to_string(i)),
+                                               reply));
+                            done();
+                        });
+    }
+    /* commands without reply */
+    m.async_command({"client", "reply", "skip"},
+                    [&](const auto &ec, const auto &reply) {
+                        REQUIRE(!ec);
+                        auto &replies =
+                            std::get<r::markers::array_holder_t>(reply);
+                        REQUIRE(replies.elements.empty());
+                        done();
+                    });
+    m.async_command({"incr", "mx:count"},
+                    [&](const auto &ec, const auto &reply) {
+                        REQUIRE(!ec);
+                        done();
+                    });
+    /* the command issued from the handler */
+    m.async_command({"ping"}, [&](const auto &ec, const auto &reply) {
+        REQUIRE(!ec);
+        REQUIRE(std::visit(r::marker_helpers::equality("PONG"), reply));
+        m.async_command({"get", "mx:count"},
+                        [&](const auto &ec, const auto &reply) {
+                            REQUIRE(!ec);
+                            REQUIRE(std::visit(r::marker_helpers::equality(
+                                                   std::to_string(count + 1)),
+                                               reply));
+                            done();
+                        });
+        done();
+    });
+    REQUIRE(m.pending() == count + 4);
+
+    while (completion_future.wait_for(sleep_delay) !=
+           std::future_status::ready) {
+        io_service.run_one();
+    }
+    REQUIRE(m.pending() == 0);
+};
+
+TEST_CASE("multiplexing of subscriptions", "[connection]") {
+    using socket_t = asio::ip::tcp::socket;
+    using next_layer_t = socket_t;
+    using Buffer = boost::asio::streambuf;
+
+    std::chrono::milliseconds sleep_delay(1);
+
+    uint16_t port = ep::get_random<ep::Kind::TCP>();
+    auto port_str = boost::lexical_cast<std::string>(port);
+    auto server = ts::make_server({"redis-server", "--port", port_str});
+    ep::wait_port<ep::Kind::TCP>(port);
+    asio::io_service io_service;
+
+    asio::ip::tcp::endpoint end_point(
+        asio::ip::address::from_string("127.0.0.1"), port);
+    socket_t socket(io_service, end_point.protocol());
+    socket.connect(end_point);
+
+    r::Multiplexer<next_layer_t> m(std::move(socket));
+    std::vector<std::string> messages;
+    std::promise<void> completion_promise;
+    auto completion_future = completion_promise.get_future();
+    m.on_push([&](const r::markers::redis_result_t &message) {
+        auto &parts = std::get<r::markers::array_holder_t>(message);
+        REQUIRE(std::visit(r::marker_helpers::equality("message"),
+                           parts.elements[0]));
+        auto &payload = std::get<r::markers::string_t>(parts.elements[2]);
+        messages.emplace_back(payload);
+        if (messages.size() == 2) {
+            completion_promise.set_value();
+        }
+    });
+
+    /* the confirmation per channel */
+    r::single_command_t subscribe{"subscribe", "ch-1", "ch-2"};
+    bool subscribed = false;
+    m.async_command(subscribe, [&](const auto &ec, const auto &reply) {
+        REQUIRE(!ec);
+        auto &replies = std::get<r::markers::array_holder_t>(reply);
+        REQUIRE(replies.elements.size() == 2);
+        r::marker_helpers::check_subscription check{subscribe};
+        REQUIRE(std::visit(check, replies.elements[0]));
+        REQUIRE(std::visit(check, replies.elements[1]));
+        subscribed = true;
+    });
+    while (!subscribed) {
+        io_service.run_one();
+    }
+
+    asio::ip::tcp::socket publisher(io_service, end_point.protocol());
+    publisher.connect(end_point);
+    r::Connection<socket_t> p(std::move(publisher));
+    Buffer rx_buff;
+    p.write(r::command_container_t{
+        r::single_command_t{"publish", "ch-1", "hello"},
+        r::single_command_t{"publish", "ch-2", "world"}});
+    for (auto i = 0; i < 2; ++i) {
+        rx_buff.consume(p.read(rx_buff).consumed);
+    }
+
+    while (completion_future.wait_for(sleep_delay) !=
+           std::future_status::ready) {
+        io_service.run_one();
+    }
+    std::vector<std::string> expected{"hello", "world"};
+    REQUIRE(messages == expected);
+
+    /* the subscribed state is left with the last channel */
+    io_service.reset();
+    REQUIRE(m.subscribed());
+    bool unsubscribed = false;
+    m.async_command({"unsubscribe", "ch-1", "ch-2"},
+                    [&](const auto &ec, const auto &reply) {
+                        REQUIRE(!ec);
+                        auto &replies =
+                            std::get<r::markers::array_holder_t>(reply);
+                        REQUIRE(replies.elements.size() == 2);
+                        unsubscribed = true;
+                    });
+    while (!unsubscribed) {
+        io_service.run_one();
+    }
+    REQUIRE(!m.subscribed());
+    // no reads are awaited anymore, i.e. the service might be stopped
+    io_service.reset();
+    bool pong = false;
+    m.async_command({"ping"}, [&](const auto &ec, const auto &reply) {
+        REQUIRE(!ec);
+        REQUIRE(std::visit(r::marker_helpers::equality("PONG"), reply));
+        pong = true;
+    });
+    while (!pong) {
+        io_service.run_one();
+    }
+};
+
+TEST_CASE("multiplexing of unsubscription of all channels", "[connection]") {
+    using socket_t = asio::ip::tcp::socket;
+    using next_layer_t = socket_t;
+
+    uint16_t port = ep::get_random<ep::Kind::TCP>();
+    auto port_str = boost::lexical_cast<std::string>(port);
+    auto server = ts::make_server({"redis-server", "--port", port_str});
+    ep::wait_port<ep::Kind::TCP>(port);
+    asio::io_service io_service;
+
+    asio::ip::tcp::endpoint end_point(
+        asio::ip::address::from_string("127.0.0.1"), port);
+    socket_t socket(io_service, end_point.protocol());
+    socket.connect(end_point);
+
+    r::Multiplexer<next_layer_t> m(std::move(socket));
+    std::size_t pushed = 0;
+    m.on_push([&](const r::markers::redis_result_t &) { ++pushed; });
+
+    std::vector<std::size_t> confirmations;
+    std::vector<std::string> pongs;
+    auto count_confirmations = [&](const auto &ec, const auto &reply) {
+        REQUIRE(!ec);
+        auto &array = std::get<r::markers::array_holder_t>(reply);
+        auto wrapped = !std::holds_alternative<r::markers::string_t>(
+            array.elements.front());
+        confirmations.push_back(wrapped ? array.elements.size() : 1);
+    };
+    auto ping = [&](const auto &ec, const auto &reply) {
+        REQUIRE(!ec);
+        pongs.emplace_back(std::get<r::markers::string_t>(reply));
+    };
+    m.async_command({"subscribe", "ch-1", "ch-2", "ch-3"},
+                    count_confirmations);
+    m.async_command({"psubscribe", "p-*"}, count_confirmations);
+    /* the confirmation per channel, the pattern is left */
+    m.async_command({"unsubscribe"}, count_confirmations);
+    m.async_command({"ping"}, ping);
+    while (pongs.size() != 1) {
+        io_service.run_one();
+    }
+    REQUIRE((confirmations == std::vector<std::size_t>{3, 1, 3}));
+    REQUIRE(m.subscribed());
+
+    /* the single confirmation of the pattern leaves subscribed state */
+    io_service.reset();
+    m.async_command({"punsubscribe"}, count_confirmations);
+    while (confirmations.size() != 4) {
+        io_service.run_one();
+    }
+    REQUIRE(confirmations.back() == 1);
+    REQUIRE(!m.subscribed());
+
+    /* the confirmation of nothing */
+    io_service.reset();
+    m.async_command({"unsubscribe"}, count_confirmations);
+    m.async_command({"ping"}, ping);
+    while (pongs.size() != 2) {
+        io_service.run_one();
+    }
+    REQUIRE(confirmations.back() == 1);
+    REQUIRE((pongs == std::vector<std::string>{"PONG", "PONG"}));
+    REQUIRE(pushed == 0);
+    REQUIRE(m.pending() == 0);
+};
@@ -0,0 +1,152 @@
+#include <boost/asio.hpp>
+#include <future>
+
+#include "EmptyPort.hpp"
+#include "TestServer.hpp"
+#include "catch.hpp"
+
+#include "bredis/Connection.hpp"
+#include "bredis/CorkedWriter.hpp"
+#include "bredis/MarkerHelpers.hpp"
+
+namespace r = bredis;
+namespace asio = boost::asio;
+namespace ep = empty_port;
+namespace ts = test_server;
+
+// counts the writes, which reach the socket
+template <typename NextLayer> struct counting_stream_t {
+    using executor_type = typename NextLayer::executor_type;
+
+    NextLayer &stream;
+    std::size_t writes = 0;
+    std::size_t max_write = 0;
+
+    executor_type get_executor() { return stream.get_executor(); }
+
+    template <typename ConstBufferSequence, typename WriteHandler>
+    void async_write_some(const ConstBufferSequence &buffers,
+                          WriteHandler &&handler) {
+        ++writes;
+        max_write = std::max(max_write, asio::buffer_size(buffers));
+        stream.async_write_some(buffers, std::forward<WriteHandler>(handler));
+    }
+};
+
+TEST_CASE("corking of writes", "[connection]") {
+    using socket_t = asio::ip::tcp::socket;
+    using next_layer_t = socket_t &;
+    using Buffer = boost::asio::streambuf;
+
+    std::chrono::milliseconds sleep_delay(1);
+
+    uint16_t port = ep::get_random<ep::Kind::TCP>();
+    auto port_str = boost::lexical_cast<std::string>(port);
+    auto server = ts::make_server({"redis-server", "--port", port_str});
+    ep::wait_port<ep::Kind::TCP>(port);
+    asio::io_service io_service;
+
+    asio::ip::tcp::endpoint end_point(
+        asio::ip::address::from_string("127.0.0.1"), port);
+    socket_t socket(io_service, end_point.protocol());
+    socket.connect(end_point);
+
+    r::Connection<next_layer_t> c(socket);
+    counting_stream_t<socket_t> counting{socket};
+    r::CorkedWriter<counting_stream_t<socket_t>> writer(counting);
+    Buffer rx_buff;
+
+    std::size_t count = 100;
+    std::size_t written = 0;
+    std::size_t written_bytes = 0;
+    auto write_all = [&](std::promise<void> &completion_promise) {
+        for (std::size_t i = 0; i < count; ++i) {
+            writer.async_write(r::single_command_t{"ping"},
+                               [&](const auto &ec, std::size_t bytes) {
+                                   REQUIRE(!ec);
+                                   written_bytes += bytes;
+                                   if (++written == count) {
+                                       completion_promise.set_value();
+                                   }
+                               });
+        }
+    };
+    auto wait_all = [&](std::promise<void> &completion_promise) {
+        auto completion_future = completion_promise.get_future();
+        while (completion_future.wait_for(sleep_delay) !=
+               std::future_status::ready) {
+            io_service.run_one();
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            auto parse_result = c.read(rx_buff);
+            REQUIRE(std::visit(r::marker_helpers::equality("PONG"),
+                               parse_result.result));
+            rx_buff.consume(parse_result.consumed);
+        }
+    };
+
+    /* the first command is written immediately, the rest are corked */
+    r::cork_options_t options;
+    options.max_commands = 10;
+    writer.options(options);
+    std::promise<void> promise_1;
+    write_all(promise_1);
+    REQUIRE(writer.queued() == count * 14);
+    wait_all(promise_1);
+    REQUIRE(counting.writes == 1 + 10);
+    REQUIRE(written_bytes == count * 14);
+    REQUIRE(writer.queued() == 0);
+
+    /* the first command lingers until the batch is full */
+    io_service.reset();
+    counting.writes = written = 0;
+    options.linger = std::chrono::microseconds(1000);
+    writer.options(options);
+    std::promise<void> promise_2;
+    write_all(promise_2);
+    wait_all(promise_2);
+    REQUIRE(counting.writes == 10);
+
+    /* the batch, which is not full, is written after linger */
+    io_service.reset();
+    counting.writes = written = 0;
+    count = 5;
+    std::promise<void> promise_3;
+    write_all(promise_3);
+    wait_all(promise_3);
+    REQUIRE(counting.writes == 1);
+
+    /* the bytes limit */
+    io_service.reset();
+    counting.writes = written = 0;
+    count = 100;
+    options = r::cork_options_t{};
+    options.max_bytes = 14 * 50;
+    writer.options(options);
+    std::promise<void> promise_4;
+    write_all(promise_4);
+    wait_all(promise_4);
+    REQUIRE(counting.writes == 1 + 2);
+
+    /* the batch is closed before the command, which does not fit */
+    io_service.reset();
+    counting.writes = written = counting.max_write = 0;
+    options.max_bytes = 14 * 50 - 1;
+    writer.options(options);
+    std::promise<void> promise_5;
+    write_all(promise_5);
+    wait_all(promise_5);
+    REQUIRE(counting.writes == 1 + 3);
+    REQUIRE(counting.max_write <= options.max_bytes);
+
+    /* the command larger than the limit is written on its own */
+    io_service.reset();
+    counting.writes = written = 0;
+    count = 10;
+    options.max_bytes = 10;
+    writer.options(options);
+    std::promise<void> promise_6;
+    write_all(promise_6);
+    wait_all(promise_6);
+    REQUIRE(counting.writes == count);
+};
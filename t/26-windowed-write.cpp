@@ -0,0 +1,93 @@
+#include <boost/asio.hpp>
+#include <future>
+
+#include "EmptyPort.hpp"
+#include "TestServer.hpp"
+#include "catch.hpp"
+
+#include "bredis/Connection.hpp"
+#include "bredis/MarkerHelpers.hpp"
+
+namespace r = bredis;
+namespace asio = boost::asio;
+namespace ep = empty_port;
+namespace ts = test_server;
+
+// records the writes, which reach the socket
+template <typename NextLayer> struct counting_stream_t {
+    using executor_type = typename NextLayer::executor_type;
+
+    NextLayer &stream;
+    std::size_t writes = 0;
+    std::size_t max_write = 0;
+
+    executor_type get_executor() { return stream.get_executor(); }
+
+    template <typename ConstBufferSequence, typename WriteHandler>
+    void async_write_some(const ConstBufferSequence &buffers,
+                          WriteHandler &&handler) {
+        ++writes;
+        max_write = std::max(max_write, asio::buffer_size(buffers));
+        stream.async_write_some(buffers, std::forward<WriteHandler>(handler));
+    }
+};
+
+TEST_CASE("windowed write", "[connection]") {
+    using socket_t = asio::ip::tcp::socket;
+    using Buffer = boost::asio::streambuf;
+
+    std::chrono::milliseconds sleep_delay(1);
+
+    uint16_t port = ep::get_random<ep::Kind::TCP>();
+    auto port_str = boost::lexical_cast<std::string>(port);
+    auto server = ts::make_server({"redis-server", "--port", port_str});
+    ep::wait_port<ep::Kind::TCP>(port);
+    asio::io_service io_service;
+
+    asio::ip::tcp::endpoint end_point(
+        asio::ip::address::from_string("127.0.0.1"), port);
+    socket_t socket(io_service, end_point.protocol());
+    socket.connect(end_point);
+
+    r::Connection<socket_t &> c(socket);
+    counting_stream_t<socket_t> counting{socket};
+    r::Connection<counting_stream_t<socket_t> &> writer(counting);
+    Buffer tx_buff, rx_buff;
+
+    c.write(r::single_command_t{"del", "wx:count"});
+    rx_buff.consume(c.read(rx_buff).consumed);
+
+    std::size_t count = 10000;
+    r::single_command_t incr{"incr", "wx:count"};
+    auto command_size = r::Protocol::serialized_size(incr);
+    r::command_container_t commands(count, incr);
+    std::size_t window = 1024;
+
+    std::promise<std::size_t> completion_promise;
+    auto completion_future = completion_promise.get_future();
+    writer.async_write_windowed(
+        tx_buff, commands,
+        [&](const auto &ec, std::size_t bytes) {
+            REQUIRE(!ec);
+            completion_promise.set_value(bytes);
+        },
+        window);
+    /* only the first window is serialized before the write */
+    REQUIRE(tx_buff.size() < window + command_size);
+
+    while (completion_future.wait_for(sleep_delay) !=
+           std::future_status::ready) {
+        io_service.run_one();
+    }
+    REQUIRE(completion_future.get() == count * command_size);
+    REQUIRE(tx_buff.size() == 0);
+    REQUIRE(counting.max_write < window + command_size);
+    REQUIRE(counting.writes >= count * command_size / counting.max_write);
+
+    for (std::size_t i = 1; i <= count; ++i) {
+        auto parse_result = c.read(rx_buff);
+        REQUIRE(std::visit(r::marker_helpers::equality(std::to_string(i)),
+                           parse_result.result));
+        rx_buff.consume(parse_result.consumed);
+    }
+};
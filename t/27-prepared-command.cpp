@@ -0,0 +1,120 @@
+#include <boost/asio.hpp>
+#include <future>
+
+#include "EmptyPort.hpp"
+#include "TestServer.hpp"
+#include "catch.hpp"
+
+#include "bredis/Connection.hpp"
+#include "bredis/MarkerHelpers.hpp"
+
+namespace r = bredis;
+namespace asio = boost::asio;
+namespace ep = empty_port;
+namespace ts = test_server;
+
+TEST_CASE("encoded commands", "[connection]") {
+    using socket_t = asio::ip::tcp::socket;
+    using next_layer_t = socket_t;
+    using Buffer = boost::asio::streambuf;
+
+    std::chrono::milliseconds sleep_delay(1);
+
+    uint16_t port = ep::get_random<ep::Kind::TCP>();
+    auto port_str = boost::lexical_cast<std::string>(port);
+    auto server = ts::make_server({"redis-server", "--port", port_str});
+    ep::wait_port<ep::Kind::TCP>(port);
+    asio::io_service io_service;
+
+    asio::ip::tcp::endpoint end_point(
+        asio::ip::address::from_string("127.0.0.1"), port);
+    socket_t socket(io_service, end_point.protocol());
+    socket.connect(end_point);
+
+    r::Connection<next_layer_t> c(std::move(socket));
+    Buffer tx_buff, rx_buff;
+    auto read_reply = [&](const std::string &expected) {
+        auto parse_result = c.read(rx_buff);
+        REQUIRE(std::visit(r::marker_helpers::equality(expected),
+                           parse_result.result));
+        rx_buff.consume(parse_result.consumed);
+    };
+
+    r::prepared_command_t del({"del", ""}, {1});
+    r::prepared_command_t incr({"incr", ""}, {1});
+    std::string keys[] = {"pc:a", "pc:b"};
+    for (const auto &key : keys) {
+        c.write(del.bind(key));
+        rx_buff.consume(c.read(rx_buff).consumed);
+    }
+
+    /* sync write */
+    c.write(incr.bind(keys[0]));
+    read_reply("1");
+
+    /* async write via buffer; the command might be rebound right away */
+    std::promise<void> promise_1;
+    c.async_write(tx_buff, incr.bind(keys[0]),
+                  [&](const auto &ec, std::size_t bytes) {
+                      REQUIRE(!ec);
+                      tx_buff.consume(bytes);
+                      promise_1.set_value();
+                  });
+    incr.bind(keys[1]);
+    auto future_1 = promise_1.get_future();
+    while (future_1.wait_for(sleep_delay) != std::future_status::ready) {
+        io_service.run_one();
+    }
+    read_reply("2");
+
+    /* zero-copy async write */
+    io_service.reset();
+    std::promise<void> promise_2;
+    c.async_write(incr, [&](const auto &ec, std::size_t bytes) {
+        REQUIRE(!ec);
+        REQUIRE(bytes == incr.size());
+        promise_2.set_value();
+    });
+    auto future_2 = promise_2.get_future();
+    while (future_2.wait_for(sleep_delay) != std::future_status::ready) {
+        io_service.run_one();
+    }
+    read_reply("1");
+
+    /* the command with the compile-time prefix */
+    io_service.reset();
+    c.write(r::cmd<r::commands::incrby>(keys[1], "10"));
+    read_reply("11");
+    std::promise<void> promise_3;
+    auto get = r::cmd<r::commands::get>(keys[1]);
+    c.async_write(get, [&](const auto &ec, std::size_t bytes) {
+        REQUIRE(!ec);
+        promise_3.set_value();
+    });
+    auto future_3 = promise_3.get_future();
+    while (future_3.wait_for(sleep_delay) != std::future_status::ready) {
+        io_service.run_one();
+    }
+    read_reply("11");
+
+    /* the owning batch */
+    io_service.reset();
+    r::command_batch_t batch;
+    for (auto i = 0; i < 100; ++i) {
+        batch.add("incr", std::string(keys[1]));
+    }
+    std::promise<void> promise_4;
+    c.async_write(tx_buff, batch, [&](const auto &ec, std::size_t bytes) {
+        REQUIRE(!ec);
+        tx_buff.consume(bytes);
+        promise_4.set_value();
+    });
+    batch.clear();
+    auto future_4 = promise_4.get_future();
+    while (future_4.wait_for(sleep_delay) != std::future_status::ready) {
+        io_service.run_one();
+    }
+    for (auto i = 12; i <= 111; ++i) {
+        read_reply(std::to_string(i));
+    }
+};
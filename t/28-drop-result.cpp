@@ -0,0 +1,94 @@
+#include <boost/asio.hpp>
+#include <future>
+
+#include "EmptyPort.hpp"
+#include "TestServer.hpp"
+#include "catch.hpp"
+
+#include "bredis/Connection.hpp"
+#include "bredis/MarkerHelpers.hpp"
+
+namespace r = bredis;
+namespace asio = boost::asio;
+namespace ep = empty_port;
+namespace ts = test_server;
+
+TEST_CASE("dropped replies of bulk writes", "[connection]") {
+    using socket_t = asio::ip::tcp::socket;
+    using next_layer_t = socket_t;
+    using Buffer = boost::asio::streambuf;
+    using Policy = r::parsing_policy::drop_result;
+    using result_t = r::positive_parse_result_t<Policy>;
+
+    std::chrono::milliseconds sleep_delay(1);
+
+    uint16_t port = ep::get_random<ep::Kind::TCP>();
+    auto port_str = boost::lexical_cast<std::string>(port);
+    auto server = ts::make_server({"redis-server", "--port", port_str});
+    ep::wait_port<ep::Kind::TCP>(port);
+    asio::io_service io_service;
+
+    asio::ip::tcp::endpoint end_point(
+        asio::ip::address::from_string("127.0.0.1"), port);
+    socket_t socket(io_service, end_point.protocol());
+    socket.connect(end_point);
+
+    r::Connection<next_layer_t> c(std::move(socket));
+    Buffer rx_buff;
+
+    /* the error reply in the middle */
+    r::command_batch_t batch;
+    for (auto i = 0; i < 1000; ++i) {
+        if (i == 500) {
+            batch.add("no-such-command");
+        } else {
+            batch.add("set", "dr:" + std::to_string(i), i);
+        }
+    }
+    /* the replies, which are not sent at all */
+    batch.add_without_reply("set", "dr:skipped", 1).reply_off();
+    for (auto i = 0; i < 100; ++i) {
+        batch.add("set", "dr:off", i);
+    }
+    batch.reply_on();
+    REQUIRE(batch.replies() == 1001);
+    c.write(batch);
+
+    std::promise<result_t> completion_promise;
+    auto completion_future = completion_promise.get_future();
+    c.async_read<Policy>(
+        rx_buff,
+        [&](const auto &ec, result_t &&result) {
+            REQUIRE(!ec);
+            rx_buff.consume(result.consumed);
+            completion_promise.set_value(std::move(result));
+        },
+        batch.replies());
+    while (completion_future.wait_for(sleep_delay) !=
+           std::future_status::ready) {
+        io_service.run_one();
+    }
+    auto result = completion_future.get();
+    REQUIRE(result.replies == 1001);
+    REQUIRE(result.errors == 1);
+    REQUIRE(result.first_error_index == 500);
+    REQUIRE(result.first_error.find("ERR") == 0);
+    REQUIRE(rx_buff.size() == 0);
+
+    /* the commands without replies are executed */
+    c.write(r::single_command_t{"get", "dr:off"});
+    auto parse_result = c.read(rx_buff);
+    REQUIRE(
+        std::visit(r::marker_helpers::equality("99"), parse_result.result));
+    rx_buff.consume(parse_result.consumed);
+
+    /* the synchronous read of dropped replies */
+    batch.clear();
+    batch.add("set", "dr:a", 1).add("set", "dr:b", 2);
+    c.write(batch);
+    r::result_storage_t<Policy> storage;
+    auto &sync_result = c.read(rx_buff, storage, batch.replies());
+    REQUIRE(sync_result.replies == 2);
+    REQUIRE(sync_result.errors == 0);
+    rx_buff.consume(sync_result.consumed);
+};
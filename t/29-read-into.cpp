@@ -0,0 +1,103 @@
+#include <boost/asio.hpp>
+#include <future>
+#include <vector>
+
+#include "EmptyPort.hpp"
+#include "TestServer.hpp"
+#include "catch.hpp"
+
+#include "bredis/Connection.hpp"
+#include "bredis/MarkerHelpers.hpp"
+
+namespace r = bredis;
+namespace asio = boost::asio;
+namespace ep = empty_port;
+namespace ts = test_server;
+
+TEST_CASE("read of bulk string into user memory", "[connection]") {
+    using socket_t = asio::ip::tcp::socket;
+    using next_layer_t = socket_t;
+    using Buffer = boost::asio::streambuf;
+    using result_t = r::positive_parse_result_t<r::parsing_policy::keep_result>;
+
+    std::chrono::milliseconds sleep_delay(1);
+
+    uint16_t port = ep::get_random<ep::Kind::TCP>();
+    auto port_str = boost::lexical_cast<std::string>(port);
+    auto server = ts::make_server({"redis-server", "--port", port_str});
+    ep::wait_port<ep::Kind::TCP>(port);
+    asio::io_service io_service;
+
+    asio::ip::tcp::endpoint end_point(
+        asio::ip::address::from_string("127.0.0.1"), port);
+    socket_t socket(io_service, end_point.protocol());
+    socket.connect(end_point);
+
+    r::Connection<next_layer_t> c(std::move(socket));
+    Buffer rx_buff;
+
+    std::string value(1024 * 1024 + 7, ' ');
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        value[i] = static_cast<char>('a' + i % 26);
+    }
+    c.write(r::single_command_t{"set", "ri:key", value});
+    auto set_result = c.read(rx_buff);
+    REQUIRE(std::visit(r::marker_helpers::equality("OK"), set_result.result));
+    rx_buff.consume(set_result.consumed);
+
+    auto read_into = [&](asio::mutable_buffer destination,
+                         boost::system::error_code &ec) {
+        std::promise<result_t> completion_promise;
+        auto completion_future = completion_promise.get_future();
+        c.async_read_into(rx_buff, destination,
+                          [&](const boost::system::error_code &error_code,
+                              result_t &&r) {
+                              ec = error_code;
+                              completion_promise.set_value(std::move(r));
+                          });
+        while (completion_future.wait_for(sleep_delay) !=
+               std::future_status::ready) {
+            io_service.run_one();
+        }
+        io_service.reset();
+        return completion_future.get();
+    };
+
+    /* the value is read right into the destination */
+    std::vector<char> slab(value.size() + 100);
+    boost::system::error_code ec;
+    c.write(r::single_command_t{"get", "ri:key"});
+    auto result = read_into(asio::buffer(slab), ec);
+    REQUIRE(!ec);
+    REQUIRE(result.consumed == 0);
+    auto &content = std::get<r::markers::string_t>(result.result);
+    REQUIRE(content.data() == slab.data());
+    REQUIRE(content == value);
+    REQUIRE(rx_buff.size() == 0);
+    /* the buffer is not grown to hold the value */
+    REQUIRE(rx_buff.capacity() < value.size());
+
+    /* the other replies are read as usual */
+    c.write(r::single_command_t{"get", "ri:no-such-key"});
+    result = read_into(asio::buffer(slab), ec);
+    REQUIRE(!ec);
+    REQUIRE(std::get_if<r::markers::nil_t>(&result.result));
+    rx_buff.consume(result.consumed);
+
+    /* the value, which does not fit, is skipped */
+    c.write(r::single_command_t{"get", "ri:key"});
+    result = read_into(asio::buffer(slab.data(), 1024), ec);
+    REQUIRE(ec == r::Error::make_error_code(r::bredis_errors::destination_size));
+    c.write(r::single_command_t{"ping"});
+    auto ping_result = c.read(rx_buff);
+    REQUIRE(std::visit(r::marker_helpers::equality("PONG"),
+                       ping_result.result));
+    rx_buff.consume(ping_result.consumed);
+
+    /* synchronous read */
+    std::vector<char> other(value.size());
+    c.write(r::single_command_t{"get", "ri:key"});
+    result = c.read_into(rx_buff, asio::buffer(other));
+    REQUIRE(std::get<r::markers::string_t>(result.result) == value);
+    REQUIRE(rx_buff.size() == 0);
+};